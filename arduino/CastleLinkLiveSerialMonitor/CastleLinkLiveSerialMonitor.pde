@@ -51,7 +51,40 @@
 #include "CastleLinkLive_config.h"
 #include "CastleLinkLive.h"
 #include "USART.h"
+#include "crc.h"
 #include "protocol.h"
+#include "stats.h"
+
+#if (DATA_LOGGER == 1)
+#include <SD.h>
+#include "logger.h"
+
+#if (LED_DISABLE == 0)
+#error "SD card shares SPI pins with the led: set LED_DISABLE in CastleLinkLive_config.h"
+#endif
+#endif
+
+/*
+ * static RAM budget: per-ESC monitor stats, sent and batch ticks and
+ * counters, library sample buffers and calibration, plus TX ring,
+ * command queue and (with DATA_LOGGER) log ring and SD sector cache.
+ * Keep it up to date when adding per-ESC state
+ */
+#define MONITOR_RAM_PER_ESC ( (2 + 12 * DATA_FRAME_CNT) + (4 * DATA_FRAME_CNT + 7) + \
+                              (4 * DATA_FRAME_CNT + 8) + 5 * (DATA_FRAME_CNT - 1) )
+#if (DATA_LOGGER == 1)
+#define MONITOR_RAM_LOG     ( LOG_RING_SIZE + 512 )
+#else
+#define MONITOR_RAM_LOG     0
+#endif
+#define MONITOR_RAM_STATIC  ( MONITOR_MAX_ESCS * MONITOR_RAM_PER_ESC + TX_BUFFER_SIZE + \
+                              QUEUE_LEN * 3 + MONITOR_RAM_LOG )
+
+#if defined(RAMEND) && defined(RAMSTART)
+#if (MONITOR_RAM_STATIC + MONITOR_STACK_RESERVE > RAMEND - RAMSTART + 1)
+#error "Monitor static RAM exceeds MCU RAM: lower CLL_PCINT_ESCS (or disable DATA_LOGGER)"
+#endif
+#endif
 
 uint8_t state = STATUS_HELLO;
 
@@ -62,32 +95,160 @@ int loopCnt = 0;
 boolean sendThrottle = true;
 boolean autoGenThrottle = false;
 volatile boolean throttlePresent = false;
+volatile uint8_t escDataReady = 0; //bitmask of ESCs with a new telemetry sample
 
 uint16_t tMin = 1000;
 uint16_t tMax = 2000;
+uint16_t tPeriod = DEFAULT_TPERIOD;
 uint8_t nESC;
 
+// data frames format and compact format state
+uint8_t dataFormat = DATAFMT_FULL;
+uint16_t lastTicks[MONITOR_MAX_ESCS][DATA_FRAME_CNT]; //last ticks sent for each ESC
+uint8_t keyframeCnt[MONITOR_MAX_ESCS]; //frames to send before next keyframe
+uint16_t batchTicks[MONITOR_MAX_ESCS][DATA_FRAME_CNT]; //samples of current telemetry cycle
+uint8_t batchMask = 0; //ESCs in batchTicks
+
+// benchmark counters: samples queued for TX or dropped (TX buffer full, or thinned by the scheduler)
+uint32_t samplesSent = 0;
+uint32_t samplesDropped = 0;
+
+// telemetry scheduler state
+uint8_t txBudget; //TX backlog (bytes) data frames may build up
+uint8_t heldCnt[MONITOR_MAX_ESCS]; //samples in a row held back for each ESC
+uint8_t schedFirst = 0; //ESC served first in next pass: round-robin
+
+// sequenced frames state
+boolean sequenced = false;
+uint8_t escSeq[MONITOR_MAX_ESCS]; //telemetry cycles completed for each ESC (rolling)
+uint8_t libSeq[MONITOR_MAX_ESCS]; //last sample sequence number from CastleLinkLive
+uint8_t batchSeq[MONITOR_MAX_ESCS]; //escSeq of samples in batchTicks
+uint32_t cyclesCompleted = 0;
+
+#if (DATA_LOGGER == 1)
+boolean logDumpPending = false;
+boolean logAutostarted = false; //standalone session running, see logAutostart()
+#endif
+
+// serial link rate: BAUD_* codes index baudRates
+const uint32_t baudRates[] = { SERIAL_BAUD_RATE, 250000, 500000, 1000000 };
+uint32_t baudRate = SERIAL_BAUD_RATE;
+uint32_t fallbackBaudRate; //rate to go back to if the host doesn't confirm
+boolean baudPending = false;
+unsigned long baudSwitchedAt;
+
+uint8_t replyTag = 0; //tag of command being processed, echoed by reply
+
+// calibration of ESC data frame selected by CMD_CAL_SELECT
+uint8_t calEsc;
+uint8_t calFrame = 0; //0: none selected
+uint16_t calGain;
+int16_t calOffset;
+
+/*
+ * 10 bits per byte on the wire. USB CDC has no wire rate: the budget is
+ * an endpoint bank, see tx_queued()
+ */
+void setTxBudget() {
+#if defined(USBCON)
+  txBudget = USB_EP_SIZE;
+#else
+  uint32_t b = baudRate / 10 * TX_LATENCY_MS / 1000;
+  txBudget = (b < TX_BUFFER_SIZE - 1) ? b : TX_BUFFER_SIZE - 1;
+#endif
+}
+
+/*
+ * switches the USART to a new rate, after everything queued for
+ * sending at the current one has left
+ */
+void setBaudRate(uint32_t rate) {
+  uart_tx_drain();
+  uart_disable_interrupt();
+  uart_init(rate);
+  uart_flush_rxbuffer();
+  uart_enable_interrupt();
+  baudRate = rate;
+  setTxBudget();
+}
+
 void reply(uint8_t ack) {
-	//let USART ISR process other incoming data since we have terminated
+	//free the command slot for USART ISR since we have terminated
 	//accessing command data
 	commandProcessed();
 
 	tx(OUT_RESPONSE_HEADER_H);
-	tx(OUT_RESPONSE_HEADER_L | (ack & 0x01) ) ;
+	if (replyTag)
+		tx(OUT_TAGGED_RESPONSE_HEADER_L | (replyTag << 1) | (ack & 0x01) );
+	else
+		tx(OUT_RESPONSE_HEADER_L | (ack & 0x01) ) ;
 }
 
+/*
+ * sends an info frame: it's the answer to a command, so it's sent
+ * blocking (even if TX buffer is full of data frames)
+ */
+void sendInfo(uint8_t id, uint8_t *payload, uint8_t len) {
+  uint8_t header[4];
+  uint8_t check[CHECK_MAXSIZE];
+  uint16_t c = checkInit(crcMode);
+
+  header[0] = OUT_RESPONSE_HEADER_H;
+  header[1] = OUT_INFO_HEADER_L;
+  header[2] = id;
+  header[3] = len;
+
+  c = checkUpdate(crcMode, c, header, sizeof(header));
+  c = checkUpdate(crcMode, c, payload, len);
+
+  txbuf(header, sizeof(header));
+  txbuf(payload, len);
+  txbuf(check, putCheck(crcMode, check, c) - check);
+}
+
+#if (DATA_LOGGER == 1)
+void sendLogStatus() {
+  uint8_t payload[7];
+  uint32_t records = logRecords();
+  uint16_t dropped = logDropped();
+
+  for (uint8_t i = 0; i < 4; i++)
+    payload[i] = records >> (24 - 8 * i);
+  payload[4] = dropped >> 8;
+  payload[5] = dropped & 0xFF;
+  payload[6] = logIsRunning();
+
+  sendInfo(INFO_LOG, payload, sizeof(payload));
+}
+#endif
+
 void processCommand(COMMAND *c) {
   int throttlePin = THROTTLE_IN_PIN;
+
+  replyTag = c->id >> CMD_TAG_SHIFT;
   
   //process command
-  switch(c->id) {
+  switch(c->id & CMD_ID_MASK) {
     case CMD_NOOP:
       reply(R_ACK);
       break;
 
     case CMD_HELLO:
+#if (DATA_LOGGER == 1)
+      if (logAutostarted) { //host takes over a standalone session: stop it, so the log can be dumped
+        logAutostarted = false;
+        CastleLinkLive.throttleDisarm();
+        logStop();
+        state = STATUS_STARTED;
+      }
+#endif
       if (state < STATUS_ARMED) {
+        baudPending = false; //host reached us: keep current rate
         state = STATUS_CONF;
+        dataFormat = DATAFMT_FULL; //new host: fall back to default format
+        sequenced = false;
+        crcMode = CRCMODE_XOR;
+        tPeriod = DEFAULT_TPERIOD;
         reply(R_ACK);
       } else
         reply(R_NACK);
@@ -109,6 +270,14 @@ void processCommand(COMMAND *c) {
         reply(R_NACK);
       break;
       
+    case CMD_SET_TPERIOD:
+      if (state == STATUS_CONF) {
+        tPeriod = (c->h << 8) | c->l; //checked by begin at START
+        reply(R_ACK);
+      } else
+        reply(R_NACK);
+      break;
+      
     case CMD_SET_TMODE:
       if (state == STATUS_CONF) {
         autoGenThrottle = (c->l > 0);
@@ -121,6 +290,7 @@ void processCommand(COMMAND *c) {
     case CMD_SET_NESC:
       if (state == STATUS_CONF) {
         nESC = c->l;
+        schedFirst = 0;
         reply(R_ACK);
       } else
         reply(R_NACK);
@@ -131,7 +301,10 @@ void processCommand(COMMAND *c) {
         if (autoGenThrottle) 
           throttlePin = GENERATE_THROTTLE;
           
-        if (CastleLinkLive.begin(nESC, throttlePin, tMin, tMax)) {
+        if (CastleLinkLive.begin(nESC, throttlePin, tMin, tMax, tPeriod)) {
+          for (uint8_t e = 0; e < nESC; e++) statsReset(e);
+          memset(escSeq, 0, sizeof(escSeq));
+          memset(libSeq, 0, sizeof(libSeq));
           state = STATUS_STARTED;
           reply(R_ACK);
         } else
@@ -167,6 +340,205 @@ void processCommand(COMMAND *c) {
       } else
         reply(R_NACK);
       break;
+
+    case CMD_SET_DATAFMT:
+      if (c->l <= DATAFMT_BATCH) {
+        dataFormat = c->l;
+        sequenced = (c->h & DATAFMT_SEQUENCED);
+        memset(keyframeCnt, 0, sizeof(keyframeCnt)); //restart from keyframes
+        batchMask = 0;
+        reply(R_ACK);
+      } else
+        reply(R_NACK);
+      break;
+
+    case CMD_GET_STATS:
+      if ( (state >= STATUS_STARTED) && (c->l < nESC) ) {
+        uint8_t payload[STATS_PAYLOAD_SIZE];
+        uint8_t esc = c->l;
+        uint8_t len = statsPayload(esc, payload);
+
+        if (c->h & STATS_READ_RESET) statsReset(esc);
+
+        sendInfo(INFO_STATS, payload, len);
+        reply(R_ACK);
+      } else
+        reply(R_NACK);
+      break;
+
+    case CMD_GET_PROFILE:
+#if (CLL_PROFILE != 0)
+      if (c->l < CLL_PROF_CNT) {
+        CLL_PROFILE_DATA prof;
+        uint8_t payload[2 + 4 * CLL_PROF_BUCKETS];
+        uint8_t *p = payload;
+
+        CastleLinkLive.getProfile(c->l, &prof, c->h & STATS_READ_RESET);
+
+        *p++ = c->l;
+        *p++ = CLL_PROF_BUCKETS;
+        for (uint8_t b = 0; b < CLL_PROF_BUCKETS; b++) {
+          *p++ = prof.latency[b] >> 8;
+          *p++ = prof.latency[b] & 0xFF;
+        }
+        for (uint8_t b = 0; b < CLL_PROF_BUCKETS; b++) {
+          *p++ = prof.duration[b] >> 8;
+          *p++ = prof.duration[b] & 0xFF;
+        }
+
+        sendInfo(INFO_PROFILE, payload, sizeof(payload));
+        reply(R_ACK);
+      } else
+#endif
+        reply(R_NACK);
+      break;
+
+    case CMD_GET_COUNTERS:
+      {
+        uint8_t payload[16];
+        uint16_t overflows = getCommandOverflows();
+        uint16_t checksumErrors = getCommandChecksumErrors();
+
+        for (uint8_t i = 0; i < 4; i++) {
+          payload[i] = samplesSent >> (24 - 8 * i);
+          payload[4 + i] = samplesDropped >> (24 - 8 * i);
+        }
+        payload[8] = overflows >> 8;
+        payload[9] = overflows & 0xFF;
+        payload[10] = checksumErrors >> 8;
+        payload[11] = checksumErrors & 0xFF;
+        for (uint8_t i = 0; i < 4; i++)
+          payload[12 + i] = cyclesCompleted >> (24 - 8 * i);
+
+        sendInfo(INFO_COUNTERS, payload, sizeof(payload));
+        reply(R_ACK);
+      }
+      break;
+
+    case CMD_SET_BAUD:
+      if ( (state == STATUS_CONF) && (! baudPending) && (c->l < (sizeof(baudRates) / sizeof(baudRates[0]))) ) {
+        uint32_t rate = baudRates[c->l]; //command slot is freed by reply
+        reply(R_ACK); //at current rate
+        fallbackBaudRate = baudRate;
+        setBaudRate(rate);
+        baudPending = true;
+        baudSwitchedAt = millis();
+      } else
+        reply(R_NACK);
+      break;
+
+    case CMD_SET_CRC:
+      if ( (state == STATUS_CONF) && (c->l <= CRCMODE_CRC16) ) {
+        uint8_t mode = c->l; //command slot is freed by reply
+        reply(R_ACK); //ACK has no check: mode applies from next frame and command
+        crcMode = mode;
+      } else
+        reply(R_NACK);
+      break;
+
+#if (DATA_LOGGER == 1)
+    case CMD_LOG:
+      switch (c->l) {
+        case LOG_STOP:
+          logStop();
+          reply(R_ACK);
+          break;
+        case LOG_START:
+          logStart();
+          reply(logIsRunning() ? R_ACK : R_NACK); //no storage
+          break;
+        case LOG_ERASE:
+          logErase();
+          reply(R_ACK);
+          break;
+        case LOG_DUMP:
+          if ( (state < STATUS_STARTED) && (! logIsRunning()) ) {
+            logDumpPending = true; //by main loop, after the ACK
+            reply(R_ACK);
+          } else
+            reply(R_NACK);
+          break;
+        case LOG_STATUS:
+          sendLogStatus();
+          reply(R_ACK);
+          break;
+        default:
+          reply(R_NACK);
+          break;
+      }
+      break;
+
+    case CMD_SET_LOGDEC:
+      if (c->l < MONITOR_MAX_ESCS) {
+        logSetDecimation(c->l, c->h);
+        reply(R_ACK);
+      } else
+        reply(R_NACK);
+      break;
+#endif
+
+    case CMD_CAL_SELECT:
+      if ( (c->l < MONITOR_MAX_ESCS) && CastleLinkLive.setCalibration(c->l, c->h, CLL_CAL_GAIN_ONE, 0) ) {
+        calEsc = c->l;
+        calFrame = c->h;
+        calGain = CLL_CAL_GAIN_ONE;
+        calOffset = 0;
+        reply(R_ACK);
+      } else
+        reply(R_NACK);
+      break;
+
+    case CMD_CAL_GAIN:
+    case CMD_CAL_OFFSET:
+      if (calFrame != 0) {
+        if ( (c->id & CMD_ID_MASK) == CMD_CAL_GAIN)
+          calGain = (c->h << 8) | c->l;
+        else
+          calOffset = (int16_t) ((c->h << 8) | c->l);
+
+        CastleLinkLive.setCalibration(calEsc, calFrame, calGain, calOffset);
+        reply(R_ACK);
+      } else
+        reply(R_NACK);
+      break;
+
+    case CMD_GET_VALUES:
+      {
+        CASTLE_ESC_DATA_FX v;
+
+        if ( (state >= STATUS_STARTED) && (c->l < nESC) && CastleLinkLive.getDataFixed(c->l, &v) ) {
+          uint8_t payload[1 + 2 * 5 + 4 + 2 * 3];
+          uint16_t w[] = { v.voltage, v.rippleVoltage, v.current, v.throttle, v.outputPower };
+          uint16_t z[] = { v.BECvoltage, v.BECcurrent, (uint16_t) v.temperature };
+          uint8_t *p = payload;
+
+          *p++ = c->l;
+          for (uint8_t i = 0; i < 5; i++) {
+            *p++ = w[i] >> 8;
+            *p++ = w[i] & 0xFF;
+          }
+          for (uint8_t i = 0; i < 4; i++)
+            *p++ = v.RPM >> (24 - 8 * i);
+          for (uint8_t i = 0; i < 3; i++) {
+            *p++ = z[i] >> 8;
+            *p++ = z[i] & 0xFF;
+          }
+
+          sendInfo(INFO_VALUES, payload, sizeof(payload));
+          reply(R_ACK);
+        } else
+          reply(R_NACK);
+      }
+      break;
+
+    case CMD_RESET_STATS:
+      if ( (state >= STATUS_STARTED) && ( (c->l < nESC) || (c->l == STATS_ALL_ESCS) ) ) {
+        for (uint8_t e = 0; e < nESC; e++)
+          if ( (c->l == e) || (c->l == STATS_ALL_ESCS) ) statsReset(e);
+        reply(R_ACK);
+      } else
+        reply(R_NACK);
+      break;
       
     default:
       reply(R_NACK);
@@ -183,9 +555,38 @@ void throttlePresence(uint8_t present) {
   throttlePresent = present;
 }
 
+/*
+ * event-handling function to attach to CastleLinkLive to be notified
+ * when a telemetry cycle for an ESC is completed. Called by an ISR (or
+ * by CastleLinkLive.poll() with CLL_DEFERRED_HANDLERS), so it just marks
+ * the ESC as ready: data is sent by main loop
+ */
+void dataAvailable(uint8_t escIndex, CASTLE_RAW_DATA *data) {
+  escDataReady |= _BV(escIndex);
+#if (DATA_LOGGER == 1)
+  logAppend(escIndex, data);
+#endif
+}
+
+/*
+ * wake check of CastleLinkLive.sleepUntilEvent: ESC data marked by
+ * the data available handler, or a command waiting
+ */
+uint8_t eventPending() {
+  return escDataReady || getNextCommand();
+}
+
+/*
+ * puts the MCU in idle mode until there's ESC data or a command waiting
+ */
+void waitForEvent() {
+  CastleLinkLive.sleepUntilEvent(eventPending);
+}
+
 void setup() {
   state = STATUS_HELLO;
   uart_init(SERIAL_BAUD_RATE);
+  setTxBudget();
   
   CastleLinkLive.init();
   
@@ -193,40 +594,313 @@ void setup() {
   //notified in case of throttle failure/recovery
   CastleLinkLive.attachThrottlePresenceHandler(throttlePresence);
 
+#if (EVENT_DRIVEN_LOOP == 1) || (DATA_LOGGER == 1)
+  CastleLinkLive.attachDataAvailableHandler(dataAvailable);
+#endif
+
+#if (DATA_LOGGER == 1)
+  logInit();
+#endif
+
   uart_enable_interrupt();  
 }
 
-void sendData(uint8_t escID, CASTLE_RAW_DATA *data) {
-  uint8_t buffer[OUT_DATA_BUFSIZE];
-  uint8_t checksum = 0;
+uint8_t dataHeaderL(uint8_t escID) {
   uint8_t tp = 0;
 
   if (throttlePresent) tp = THROTTLE_PRESENT;
 
-  buffer[0] = OUT_DATA_HEADER_H;
-  buffer[1] = OUT_DATA_HEADER_L | tp | (escID & ESC_ID_MASK);
-      
-  checksum  = buffer[0];
-  checksum ^= buffer[1];
-      
-  for (int i = 0; i < DATA_FRAME_CNT; i++) {
-    buffer[(i * 2) + 2] = data->ticks[i] >> 8;
-    buffer[(i * 2) + 3] = data->ticks[i] & 0xFF;
-    checksum ^= buffer[(i * 2) + 2];
-    checksum ^= buffer[(i * 2) + 3];
+  return OUT_DATA_HEADER_L | tp | (escID & ESC_ID_MASK);
+}
+
+/*
+ * full and batch frames are written directly in the TX buffer: frame
+ * check is updated while writing, no staging buffer
+ */
+static inline uint16_t txFramePut(uint8_t mode, uint16_t check, uint8_t b) {
+  tx_put_reserved(b);
+  return checkByte(mode, check, b);
+}
+
+static inline uint16_t txFramePutTicks(uint8_t mode, uint16_t check, uint16_t *ticks) {
+  for (uint8_t i = 0; i < DATA_FRAME_CNT; i++) {
+    check = txFramePut(mode, check, ticks[i] >> 8);
+    check = txFramePut(mode, check, ticks[i] & 0xFF);
   }
-      
-  buffer[OUT_DATA_BUFSIZE -1] = checksum;
-  txbuf(buffer, OUT_DATA_BUFSIZE);
-   
+
+  return check;
+}
+
+static inline void txFrameEnd(uint8_t mode, uint16_t check) {
+  if (mode == CRCMODE_CRC16) tx_put_reserved(check >> 8);
+  tx_put_reserved(check & 0xFF);
+  tx_commit();
+}
+
+boolean sendFullData(uint8_t escID, CASTLE_RAW_DATA *data) {
+  uint8_t mode = crcMode;
+  uint16_t c = checkInit(mode);
+
+  if (! tx_reserve(2 + (sequenced ? 1 : 0) + 2 * DATA_FRAME_CNT + checkSize(mode)) ) return false;
+
+  c = txFramePut(mode, c, OUT_DATA_HEADER_H);
+  c = txFramePut(mode, c, dataHeaderL(escID));
+  if (sequenced) c = txFramePut(mode, c, escSeq[escID]);
+  c = txFramePutTicks(mode, c, data->ticks);
+
+  txFrameEnd(mode, c);
+  return true;
+}
+
+/*
+ * compact frame: only data frames changed since last frame sent for the
+ * ESC are sent, as deltas. Every COMPACT_KEYFRAME_INTERVAL frames a
+ * keyframe with all absolute values lets the host (re)synchronize
+ */
+boolean sendCompactData(uint8_t escID, CASTLE_RAW_DATA *data) {
+  uint8_t buffer[OUT_COMPACT_MAXSIZE + CHECK_MAXSIZE];
+  uint8_t *p = buffer + (sequenced ? 5 : 4);
+  uint16_t *last = lastTicks[escID];
+  uint16_t bitmap = 0;
+  boolean key = (keyframeCnt[escID] == 0);
+
+  for (int f = 0; f < DATA_FRAME_CNT; f++) {
+    uint16_t t = data->ticks[f];
+
+    if (key) {
+      p = putVarint(p, t);
+      bitmap |= (1 << f);
+    } else if (t != last[f]) {
+      p = putVarint(p, zigzag16(t - last[f]));
+      bitmap |= (1 << f);
+    }
+  }
+
+  if (key) bitmap |= COMPACT_KEYFRAME;
+
+  uint8_t *h = buffer;
+
+  *h++ = OUT_COMPACT_HEADER_H;
+  *h++ = dataHeaderL(escID);
+  if (sequenced) *h++ = escSeq[escID];
+  *h++ = bitmap >> 8;
+  *h = bitmap & 0xFF;
+
+  p = putCheck(crcMode, p, checkUpdate(crcMode, checkInit(crcMode), buffer, p - buffer));
+
+  //host keeps track of what it received: only update our copy if sent
+  if (! txbuf_async(buffer, p - buffer)) return false;
+
+  memcpy(last, data->ticks, sizeof(uint16_t) * DATA_FRAME_CNT);
+  keyframeCnt[escID] = key ? COMPACT_KEYFRAME_INTERVAL : keyframeCnt[escID] - 1;
+
+  return true;
+}
+
+boolean sendBatch() {
+  uint8_t mode = (crcMode == CRCMODE_XOR) ? CRCMODE_CRC8 : crcMode; //batch frames are always CRC protected
+  uint16_t c = checkInit(mode);
+  uint8_t mask = batchMask;
+  uint8_t len = 3 + checkSize(mode);
+
+  batchMask = 0;
+
+  for (uint8_t e = 0; e < nESC; e++) {
+    if (mask & _BV(e)) len += (sequenced ? 1 : 0) + 2 * DATA_FRAME_CNT;
+  }
+
+  if (! tx_reserve(len)) return false;
+
+  c = txFramePut(mode, c, OUT_BATCH_HEADER_H);
+  c = txFramePut(mode, c, dataHeaderL(0));
+  c = txFramePut(mode, c, mask);
+
+  for (uint8_t e = 0; e < nESC; e++) {
+    if (! (mask & _BV(e)) ) continue;
+
+    if (sequenced) c = txFramePut(mode, c, batchSeq[e]);
+    c = txFramePutTicks(mode, c, batchTicks[e]);
+  }
+
+  txFrameEnd(mode, c);
+  return true;
+}
+
+/*
+ * batch frames: samples are collected until every ESC has one. If an
+ * ESC sends a new sample before that (i.e. another ESC is not ticking)
+ * the partial batch is sent as is
+ */
+boolean batchData(uint8_t escID, CASTLE_RAW_DATA *data) {
+  boolean ret = true;
+
+  if (batchMask & _BV(escID)) ret = sendBatch(); //a new cycle begun
+
+  memcpy(batchTicks[escID], data->ticks, sizeof(uint16_t) * DATA_FRAME_CNT);
+  batchSeq[escID] = escSeq[escID];
+  batchMask |= _BV(escID);
+
+  if (batchMask == (uint8_t) (_BV(nESC) - 1)) ret = sendBatch(); //cycle complete
+
+  return ret;
+}
+
+/*
+ * queues an ESC data frame for background transmission: if there's
+ * no room left in the TX buffer the frame is dropped
+ */
+boolean sendData(uint8_t escID, CASTLE_RAW_DATA *data) {
+  if (dataFormat == DATAFMT_COMPACT)
+    return sendCompactData(escID, data);
+  else if (dataFormat == DATAFMT_BATCH)
+    return batchData(escID, data);
+  else if (dataFormat == DATAFMT_FULL)
+    return sendFullData(escID, data);
+  else
+    return true;
 }
 
+/*
+ * telemetry scheduler: tells whether a sample can be sent with current
+ * TX backlog. Changed samples may fill half of txBudget, unchanged ones
+ * a quarter; each sample held back before adds a quarter. An empty
+ * buffer always takes a sample, however small txBudget is
+ */
+boolean schedAdmit(uint8_t escID, CASTLE_RAW_DATA *data) {
+  uint8_t queued = tx_queued();
+  uint8_t level = heldCnt[escID] + 1;
+
+  if ( (queued == 0) || (dataFormat == DATAFMT_NONE) ) return true;
+
+  for (int f = 0; f < DATA_FRAME_CNT; f++) {
+    int16_t d = data->ticks[f] - lastTicks[escID][f];
+
+    if ( (d > SCHED_CHANGE_TICKS) || (d < -SCHED_CHANGE_TICKS) ) {
+      level++;
+      break;
+    }
+  }
+
+  if (level >= 4) return (queued < txBudget);
+  return (queued < (uint16_t) txBudget * level / 4);
+}
+
+/*
+ * a new telemetry sample is available for an ESC
+ */
+void escSample(uint8_t escID, CASTLE_RAW_DATA *data, uint8_t seq) {
+  uint8_t cycles = seq - libSeq[escID];
+
+  if (libSeq[escID] == 0)
+    cycles = 1; //first sample
+  else if (seq < libSeq[escID])
+    cycles--; //library sequence skips 0 when wrapping
+
+  libSeq[escID] = seq;
+  escSeq[escID] += cycles;
+  cyclesCompleted += cycles;
+
+  //host drops sequenced compact deltas after a gap: resync it at once
+  if (sequenced && (cycles != 1)) keyframeCnt[escID] = 0;
+
+  statsUpdate(escID, data);
+
+  if (! schedAdmit(escID, data)) {
+    if (heldCnt[escID] < 3) heldCnt[escID]++;
+    if (sequenced) keyframeCnt[escID] = 0;
+    samplesDropped++;
+    return;
+  }
+
+  heldCnt[escID] = 0;
+  if (! sendData(escID, data)) {
+    if (sequenced) keyframeCnt[escID] = 0;
+    samplesDropped++;
+    return;
+  }
+
+  //compact frames keep lastTicks as delta base: updated only when sent
+  if (dataFormat != DATAFMT_COMPACT)
+    memcpy(lastTicks[escID], data->ticks, sizeof(uint16_t) * DATA_FRAME_CNT);
+
+  samplesSent++;
+}
+
+#if (DATA_LOGGER == 1)
+/*
+ * sends every stored record as an INFO_LOG_RECORD info frame (ESC index and
+ * timestamp) followed by a full data frame, then log status as end marker
+ */
+void logDump() {
+  LOG_RECORD r;
+  uint8_t payload[5];
+  uint32_t n = logRecords();
+
+  for (uint32_t i = 0; i < n; i++) {
+    if (! logReadRecord(i, &r)) break;
+
+    payload[0] = r.esc;
+    for (uint8_t b = 0; b < 4; b++)
+      payload[1 + b] = r.timestamp >> (24 - 8 * b);
+
+    sendInfo(INFO_LOG_RECORD, payload, sizeof(payload));
+    while (! sendFullData(r.esc, &r.data)); //wait for room in TX buffer
+  }
+
+  sendLogStatus();
+}
+
+/*
+ * standalone run: no host said hello, so start by ourselves relaying
+ * external throttle, and log
+ */
+void logAutostart() {
+  nESC = LOG_AUTOSTART_NESC;
+
+  if (! CastleLinkLive.begin(nESC, THROTTLE_IN_PIN, tMin, tMax)) {
+    state = STATUS_CONF; //don't try again: wait for a host
+    return;
+  }
+
+  for (uint8_t e = 0; e < nESC; e++) statsReset(e);
+  memset(escSeq, 0, sizeof(escSeq));
+  memset(libSeq, 0, sizeof(libSeq));
+  CastleLinkLive.throttleArm();
+  state = STATUS_ARMED;
+  logAutostarted = true;
+  logStart();
+}
+#endif
+
 void loop() {
   CASTLE_RAW_DATA escData;
-  COMMAND *command = getNextCommand();
+  uint8_t seq;
+  COMMAND *command;
+
+  while ( (command = getNextCommand()) ) processCommand(command); //process all queued commands
 
-  if ( command ) processCommand(command);
+#if (CLL_DEFERRED_HANDLERS != 0)
+  CastleLinkLive.poll(); //run data available handler out of interrupt context
+#endif
   
+  if ( baudPending && (millis() - baudSwitchedAt > BAUD_CONFIRM_TIMEOUT) ) {
+    baudPending = false; //no HELLO at new rate: host couldn't follow us
+    setBaudRate(fallbackBaudRate);
+  }
+
+#if (DATA_LOGGER == 1)
+  logFlush(false);
+
+  if (logDumpPending) {
+    logDumpPending = false;
+    logDump();
+  }
+
+#if (LOG_AUTOSTART_MS > 0)
+  if ( (state == STATUS_HELLO) && (millis() > LOG_AUTOSTART_MS) ) logAutostart();
+#endif
+#endif
+
   switch(state) {
     case STATUS_HELLO:
 #if (LED_DISABLE == 0)
@@ -257,22 +931,46 @@ void loop() {
 		memset(&escData, 0, sizeof(CASTLE_RAW_DATA));
 		escData.ticks[FRAME_REFERENCE] = 2000;
 		escData.ticks[FRAME_TEMP2] = 1000;
-		sendData(0, &escData);
+		sendFullData(0, &escData); //in any data format: host still needs throttle presence
         delay(100);
       } else {
-        for (int e = 0; e < nESC; e++) {
-          if (CastleLinkLive.getData(e, &escData))
-            sendData(e, &escData);
+#if (EVENT_DRIVEN_LOOP == 1)
+        uint8_t ready;
+
+        cli();
+        ready = escDataReady;
+        escDataReady = 0;
+        sei();
+
+        for (uint8_t i = 0, e = schedFirst; i < nESC; i++, e = (e + 1 < nESC) ? e + 1 : 0) {
+          if ( (ready & _BV(e)) && CastleLinkLive.getDataIfNew(e, &escData, &seq) )
+            escSample(e, &escData, seq);
 
           if ( (command = getNextCommand()) ) processCommand(command); //give a chance to execute a command
         }
+#else
+        for (uint8_t i = 0, e = schedFirst; i < nESC; i++, e = (e + 1 < nESC) ? e + 1 : 0) {
+          if (CastleLinkLive.getDataIfNew(e, &escData, &seq))
+            escSample(e, &escData, seq);
 
+          if ( (command = getNextCommand()) ) processCommand(command); //give a chance to execute a command
+        }
+#endif
+        if (++schedFirst >= nESC) schedFirst = 0; //no ESC always gets the TX buffer first
       }
       break; 
   }
   
   loopCnt++;
   loopCnt = loopCnt % 100;
+
+#if (EVENT_DRIVEN_LOOP == 1)
+  if ( (state == STATUS_ARMED) && throttlePresent ) {
+    waitForEvent();
+    return;
+  }
+#endif
+
   delay(loopDelay);
 }
 
@@ -26,16 +26,173 @@
 #else
 #include "WProgram.h"
 #endif
+#include "config.h"
 #include "USART.h"
+#include "crc.h"
 #include "protocol.h"
 
 char buffer[commandSize];
 int8_t bufcnt = -1;
 uint8_t checksum;
+uint8_t crc;
+
+/*
+ * command parser, shared by transports: called for every received
+ * byte, queues complete commands with a valid checksum
+ */
+static inline void rx_parse(uint8_t c) {
+  if ( bufcnt == -1 ) {
+    if (c == CMD_HEADER) bufcnt = 0; //header ok: start filling buffer
+    return; 
+  } else if (bufcnt == (int) commandSize) { //buffer full: check checksum
+    uint8_t ok = (crcMode == CRCMODE_XOR) ? (checksum == c) : (crc == c);
+    if ( (! ok) && ((buffer[0] & CMD_ID_MASK) == CMD_HELLO) ) ok = (checksum == c); //new host: always XOR
+
+    if (ok) //checksum ok: queue the command
+    	queueCommand(buffer);
+    else
+    	cmdChecksumErrors++;
+
+    bufcnt = -1; //reset buffer
+    return;
+  }
+  
+  //filling buffer
+  buffer[bufcnt++] = c;
+  if (bufcnt == 1) {
+    checksum  = c;
+    crc = crc8_update(0, c);
+  } else {
+    checksum ^= c;
+    crc = crc8_update(crc, c);
+  }
+  
+}
+
+#if defined(USBCON)
+
+/*
+ * USB CDC transport (ATmega32U4 and other native USB boards): no baud
+ * rate, no UART interrupts. Frames queued with txbuf_async are sent
+ * right away as a single USB packet (if they fit in an endpoint bank),
+ * commands are read by polling
+ */
+
+// frames built in place are staged here and handed to the USB core at
+// once by tx_commit: a Serial.write per byte costs a USB_Send each
+uint8_t txRing[TX_BUFFER_SIZE];
+uint8_t txCursor;
+uint8_t tx_free() {
+  int n = Serial.availableForWrite();
+  return (n > 255) ? 255 : n;
+}
+
+/*
+ * bytes in the bank being filled: a bank is released at every frame
+ * commit, so backlog shows up when the host stops reading and no bank
+ * is free (availableForWrite() is 0 then)
+ */
+uint8_t tx_queued() {
+  int n = USB_EP_SIZE - Serial.availableForWrite();
+  return (n < 0) ? 0 : n;
+}
 
 void tx(char data) {
-  while( ( UCSR0A & _BV(UDRE0) )==0 );
-  UDR0 = data;
+  Serial.write((uint8_t) data); //USB core flushes it at next start of frame
+}
+
+void txstr(char *str) {
+  Serial.write(str);
+}
+
+void txbuf(uint8_t *b, uint16_t count) {
+  Serial.write(b, count);
+}
+
+uint8_t tx_reserve(uint8_t count) {
+  if (count > TX_BUFFER_SIZE - 1) return false; //doesn't fit in staging buffer, as on USART
+
+  //longer frames need an empty bank, and block for the rest
+  uint8_t need = (count < USB_EP_SIZE) ? count : USB_EP_SIZE;
+  if (tx_free() < need) return false;
+
+  txCursor = 0;
+  return true;
+}
+
+void tx_commit() {
+  Serial.write(txRing, txCursor);
+  Serial.flush(); //release the bank: frame leaves in one packet
+}
+
+uint8_t txbuf_async(uint8_t *b, uint8_t count) {
+  if (! tx_reserve(count)) return false;
+
+  Serial.write(b, count); //already contiguous: no staging
+  Serial.flush();
+  return true;
+}
+
+void uart_tx_drain() {
+  Serial.flush();
+}
+
+unsigned char rx(void) {
+  int c;
+  while ( (c = Serial.read()) < 0 );
+  return c;
+}
+
+unsigned char rx_nb(void) {
+  int c = Serial.read();
+  return (c < 0) ? 0 : c;
+}
+
+void uart_init(uint32_t baudrate) {
+  Serial.begin(baudrate); //ignored by CDC
+  bufcnt = -1;
+}
+
+void uart_flush_rxbuffer() {
+  while (Serial.available() > 0) Serial.read();
+}
+
+void uart_poll() {
+  while (Serial.available() > 0) rx_parse(Serial.read());
+}
+
+#else
+
+// TX ring buffer: filled by main context, drained by USART UDRE ISR
+uint8_t txRing[TX_BUFFER_SIZE];
+volatile uint8_t txHead = 0;
+volatile uint8_t txTail = 0;
+volatile uint8_t txWritten = 0; //something was sent since uart_init: TXC0 is meaningful
+uint8_t txCursor; //next byte of the frame being built in place
+
+#define TX_RING_MASK (TX_BUFFER_SIZE - 1)
+
+uint8_t tx_free() {
+  return TX_RING_MASK - ((uint8_t) (txHead - txTail) & TX_RING_MASK);
+}
+
+uint8_t tx_queued() {
+  return (uint8_t) (txHead - txTail) & TX_RING_MASK;
+}
+
+/*
+ * Puts a byte in the ring buffer: caller must check there's space for it
+ */
+static inline void tx_put(uint8_t data) {
+  uint8_t head = txHead;
+  txRing[head] = data;
+  txHead = (head + 1) & TX_RING_MASK;
+}
+
+void tx(char data) {
+  while ( tx_free() == 0 ); //wait for UDRE ISR to make room
+  tx_put(data);
+  UCSR0B |= _BV(UDRIE0); //let UDRE ISR send it
 }
 
 void txstr(char *str) {
@@ -52,6 +209,29 @@ void txbuf(uint8_t *b, uint16_t count) {
      tx( *(b + i) );
 }
 
+uint8_t tx_reserve(uint8_t count) {
+  if (tx_free() < count) return false; //not enough room: don't send a partial frame
+
+  txCursor = txHead;
+  return true;
+}
+
+uint8_t txbuf_async(uint8_t *b, uint8_t count) {
+  if (! tx_reserve(count)) return false;
+
+  for (uint8_t i = 0; i < count; i++)
+    tx_put_reserved( *(b + i) );
+
+  tx_commit();
+  return true;
+}
+
+void uart_tx_drain() {
+  while (txHead != txTail); //wait for UDRE ISR to empty the ring
+  if (! txWritten) return;
+  while ( ( UCSR0A & _BV(TXC0) ) == 0 ); //wait for last byte to leave the shift register
+}
+
 unsigned char rx(void) {
   while( ( UCSR0A & _BV(RXC0) )==0 );
   return UDR0;
@@ -66,11 +246,21 @@ unsigned char rx_nb(void) {
   return retval;
 }
 
+static uint32_t baud_error(uint32_t actual, uint32_t wanted) {
+  return (actual > wanted) ? actual - wanted : wanted - actual;
+}
+
 /*
- * From arduino HardwareSerial.cpp
+ * From arduino HardwareSerial.cpp: picks the divisor (with or without
+ * U2X) giving the rate nearest to baudrate. At 16MHz 250k, 500k and 1M
+ * are exact in both modes: U2X is used only when it's strictly better,
+ * as normal mode samples each bit 16 times instead of 8
  */
-void uart_init(uint16_t baudrate) {
-  short use_u2x = 1;
+void uart_init(uint32_t baudrate) {
+  uint16_t baud_u2x = (F_CPU / 4 / baudrate - 1) / 2;
+  uint16_t baud_1x = (F_CPU / 8 / baudrate - 1) / 2;
+  short use_u2x = ( baud_error(F_CPU / 8 / (baud_u2x + 1), baudrate) <
+                    baud_error(F_CPU / 16 / (baud_1x + 1), baudrate) );
   uint16_t baud_val;
         
 #if F_CPU == 16000000UL
@@ -83,15 +273,18 @@ void uart_init(uint16_t baudrate) {
 	
   if (use_u2x) {
     UCSR0A = _BV(U2X0);
-    baud_val = (F_CPU / 4 / baudrate - 1) / 2;
+    baud_val = baud_u2x;
   } else {
     UCSR0A = 0;
-    baud_val = (F_CPU / 8 / baudrate - 1) / 2;          
+    baud_val = baud_1x;
   }
 
   UBRR0L = baud_val;
   UBRR0H = baud_val >> 8;		
 
+  txHead = txTail = 0;
+  txWritten = 0;
+  bufcnt = -1; //drop any partially received command
   UCSR0B = _BV(RXEN0) | _BV(TXEN0);
 	
 }
@@ -102,28 +295,27 @@ void uart_flush_rxbuffer() {
 }
 
 /*
- * USART RX Interrupt
+ * USART Data Register Empty Interrupt: sends next byte from TX ring buffer
  */
-ISR(USART_RX_vect /*, ISR_NOBLOCK */) {
-  uint8_t c = UDR0;
-
-  if ( bufcnt == -1 ) {
-    if (c == CMD_HEADER) bufcnt = 0; //header ok: start filling buffer
-    return; 
-  } else if (bufcnt == (int) commandSize) { //buffer full: check checksum
-    if (checksum == c) //checksum ok: queue the command
-    	queueCommand(buffer);
+ISR(USART_UDRE_vect) {
+  uint8_t tail = txTail;
 
-    bufcnt = -1; //reset buffer
+  if (txHead == tail) { //nothing more to send
+    UCSR0B &= ~( _BV(UDRIE0) );
     return;
   }
-  
-  //filling buffer
-  buffer[bufcnt++] = c;
-  if (bufcnt == 1)
-    checksum  = c;
-  else
-    checksum ^= c;
-  
+
+  UCSR0A = ( UCSR0A & _BV(U2X0) ) | _BV(TXC0); //clear transmit complete flag (keeping U2X)
+  txWritten = 1;
+  UDR0 = txRing[tail];
+  txTail = (tail + 1) & TX_RING_MASK;
 }
 
+/*
+ * USART RX Interrupt
+ */
+ISR(USART_RX_vect /*, ISR_NOBLOCK */) {
+  rx_parse(UDR0);
+}
+
+#endif
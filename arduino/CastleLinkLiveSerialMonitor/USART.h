@@ -23,13 +23,66 @@
 #ifndef USART_H
 #define USART_H
 
+// TX ring buffer size: must be a power of 2, max 256
+#ifndef TX_BUFFER_SIZE
+#define TX_BUFFER_SIZE 128
+#endif
+
+// USB CDC transport: size of an endpoint bank
+#if defined(USBCON) && !defined(USB_EP_SIZE)
+#define USB_EP_SIZE 64
+#endif
+
 void txbuf(uint8_t *b, uint16_t count);
+uint8_t txbuf_async(uint8_t *b, uint8_t count);
+uint8_t tx_free();
+uint8_t tx_queued(); //bytes waiting to be sent
 void txstr(char *str);
 void tx(char data);
 unsigned char rx(void);
 unsigned char rx_nb(void);
 void uart_flush_rxbuffer();
-void uart_init(uint16_t baudrate);
+void uart_tx_drain();
+void uart_init(uint32_t baudrate);
+
+/*
+ * frames built in place: tx_reserve(count) checks there's room for the
+ * whole frame (same policy as txbuf_async), then exactly count bytes are
+ * written with tx_put_reserved and tx_commit queues them for sending
+ */
+uint8_t tx_reserve(uint8_t count);
+
+// TX ring on USART0, frame staging buffer on USB CDC
+extern uint8_t txRing[TX_BUFFER_SIZE];
+extern uint8_t txCursor;
+
+static inline void tx_put_reserved(uint8_t data) {
+  txRing[txCursor] = data;
+  txCursor = (txCursor + 1) & (TX_BUFFER_SIZE - 1);
+}
+
+/*
+ * transport: USB CDC on native USB boards (commands are polled),
+ * USART0 elsewhere (commands are received by RX interrupt)
+ */
+#if defined(USBCON)
+
+void uart_poll();
+void tx_commit();
+
+#define uart_enable_interrupt()
+#define uart_disable_interrupt()
+
+#else
+
+static inline void uart_poll() {}
+
+extern volatile uint8_t txHead;
+
+static inline void tx_commit() {
+  txHead = txCursor; //UDRE ISR sees the whole frame at once
+  UCSR0B |= _BV(UDRIE0);
+}
 
 //define uart enable disable interrupts as macros
 #define uart_enable_interrupt() ( UCSR0B |= _BV(RXCIE0) )
@@ -37,3 +90,5 @@ void uart_init(uint16_t baudrate);
 
 #endif
 
+#endif
+
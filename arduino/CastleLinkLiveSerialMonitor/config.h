@@ -22,7 +22,7 @@
 
 
 /****************** CONFIGS ***********************/
-#define SERIAL_BAUD_RATE            38400
+#define SERIAL_BAUD_RATE            38400 //at startup: host can switch to higher rates with CMD_SET_BAUD
 #define LED                            13
 
 /* 
@@ -33,4 +33,75 @@
  */
 #define THROTTLE_IN_PIN                 7
 
+/*
+ * default generated throttle period (us): host can change it
+ * with CMD_SET_TPERIOD
+ */
+#define DEFAULT_TPERIOD             20000
+
+/*
+ * max ESCs the monitor keeps per-ESC state for
+ */
+#include "CastleLinkLive_config.h" //for CLL_PCINT_ESCS
+
+#if defined(__AVR_ATmega32U4__)
+#define MONITOR_MAX_ESCS                5
+#elif defined(__AVR_ATmega168__) || defined(__AVR_ATmega328P__)
+#define MONITOR_MAX_ESCS                ( 2 + CLL_PCINT_ESCS )
+#else
+#define MONITOR_MAX_ESCS                2
+#endif
+
+/*
+ * static RAM left for the stack (and Arduino core) by the RAM budget
+ * check in CastleLinkLiveSerialMonitor.pde: per-ESC state grows with
+ * MONITOR_MAX_ESCS (about 290 bytes each, monitor and library), so a
+ * board can run out of RAM at runtime even if the sketch builds
+ */
+#define MONITOR_STACK_RESERVE         256
+
+/*
+ * TX ring must hold a whole batch frame (up to 189 bytes with 8 ESCs)
+ */
+#if (MONITOR_MAX_ESCS > 5)
+#define TX_BUFFER_SIZE                256
+#endif
+
+/*
+ * telemetry scheduler: data frames may fill the TX buffer only up to what
+ * drains in TX_LATENCY_MS at current baud rate, so a response never
+ * waits longer than that (plus one frame) behind telemetry. When the link
+ * can't keep up, samples are thinned: unchanged ones (no data frame moved
+ * more than SCHED_CHANGE_TICKS since last sent) go first, and every sample
+ * held back raises the priority of the next one from the same ESC.
+ * On USB CDC (no baud rate) the budget is one endpoint bank instead:
+ * data frames give way while banks wait for the host, so a response
+ * waits at most for the banks already queued
+ */
+#define TX_LATENCY_MS                  20
+#define SCHED_CHANGE_TICKS              8
+
+/*
+ * when armed with a valid throttle signal, instead of polling every
+ * loopDelay ms, the main loop sleeps (idle mode) until CastleLinkLive
+ * signals new ESC data or a command is received, and sends exactly
+ * one frame per completed telemetry cycle.
+ * Set to 0 to go back to fixed-delay polling.
+ */
+#define EVENT_DRIVEN_LOOP               1
+
+/*
+ * on-device telemetry log to SD card (chip select on LOG_SD_CS_PIN,
+ * see logger.h). SD card uses SPI pins: led pin too on most boards,
+ * so LED_DISABLE must be set in CastleLinkLive_config.h.
+ * If no host says hello within LOG_AUTOSTART_MS after power on, the
+ * monitor starts by itself relaying throttle from THROTTLE_IN_PIN to
+ * LOG_AUTOSTART_NESC ESCs and logs their telemetry (0: never autostart).
+ * A host saying hello later stops that session (throttle relay and log),
+ * so it can dump the log
+ */
+#define DATA_LOGGER                     0
+#define LOG_AUTOSTART_MS             5000
+#define LOG_AUTOSTART_NESC              1
+
 
@@ -0,0 +1,76 @@
+/*****************************************************************************
+ *  CastleLinkLiveSerialMonitor - crc.h
+ *  Copyright (C) 2026  CastleLinkLive contributors
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  For further info, check http://code.google.com/p/castlelinklive4arduino/
+ *
+ *  SVN $Id$
+ *****************************************************************************/
+
+#ifndef CRC_H
+#define CRC_H
+
+#include <avr/pgmspace.h>
+
+/*
+ * 1: 256 entries tables (768 bytes of flash), one lookup per byte
+ * 0: 16 entries tables (48 bytes of flash), two lookups per byte
+ */
+#ifndef CRC_TABLE_FULL
+#define CRC_TABLE_FULL 1
+#endif
+
+#define CRC8_POLY                          0x07 //x^8 + x^2 + x + 1, initial value 0
+#define CRC16_POLY                       0x1021 //CCITT: x^16 + x^12 + x^5 + 1
+#define CRC16_INIT                       0xFFFF
+
+/*
+ * both CRCs are MSB first, not reflected, without final XOR
+ */
+#if (CRC_TABLE_FULL == 1)
+
+extern const uint8_t crc8Table[256] PROGMEM;
+extern const uint16_t crc16Table[256] PROGMEM;
+
+static inline uint8_t crc8_update(uint8_t crc, uint8_t b) {
+	return pgm_read_byte(&crc8Table[crc ^ b]);
+}
+
+static inline uint16_t crc16_update(uint16_t crc, uint8_t b) {
+	return (crc << 8) ^ pgm_read_word(&crc16Table[(crc >> 8) ^ b]);
+}
+
+#else
+
+extern const uint8_t crc8Nibble[16] PROGMEM;
+extern const uint16_t crc16Nibble[16] PROGMEM;
+
+static inline uint8_t crc8_update(uint8_t crc, uint8_t b) {
+	crc ^= b;
+	crc = (uint8_t) (crc << 4) ^ pgm_read_byte(&crc8Nibble[crc >> 4]);
+	crc = (uint8_t) (crc << 4) ^ pgm_read_byte(&crc8Nibble[crc >> 4]);
+	return crc;
+}
+
+static inline uint16_t crc16_update(uint16_t crc, uint8_t b) {
+	crc = (crc << 4) ^ pgm_read_word(&crc16Nibble[(crc >> 12) ^ (b >> 4)]);
+	crc = (crc << 4) ^ pgm_read_word(&crc16Nibble[(crc >> 12) ^ (b & 0x0F)]);
+	return crc;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,233 @@
+/*****************************************************************************
+ *  CastleLinkLiveSerialMonitor - logger.cpp
+ *  Copyright (C) 2026  CastleLinkLive contributors
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  For further info, check http://code.google.com/p/castlelinklive4arduino/
+ *
+ *  SVN $Id$
+ *****************************************************************************/
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+#include "config.h"
+
+#if (DATA_LOGGER == 1)
+
+#include <SD.h>
+#include "logger.h"
+
+#define LOG_RING_MASK (LOG_RING_SIZE - 1)
+
+// RAM ring: filled by logAppend (ISR), drained by logFlush (main context)
+uint8_t logRing[LOG_RING_SIZE];
+volatile uint16_t logHead = 0;
+volatile uint16_t logTail = 0;
+
+volatile uint8_t logRunning = false;
+volatile uint16_t logDropCnt = 0; //records lost because ring was full
+uint8_t logDecimation[MONITOR_MAX_ESCS]; //log one sample every N
+uint8_t logSkip[MONITOR_MAX_ESCS]; //samples to skip before next logged one
+
+uint8_t storageOk = false;
+File logFile;
+
+/************** STORAGE ******************/
+
+static uint8_t storageBegin() {
+  pinMode(LOG_SD_CS_PIN, OUTPUT);
+  if (! SD.begin(LOG_SD_CS_PIN)) return false;
+
+  logFile = SD.open(LOG_FILE_NAME, FILE_WRITE); //appends
+  if (! logFile) return false;
+  return true;
+}
+
+static void storageWrite(uint8_t *b, uint16_t len) {
+  logFile.write(b, len);
+}
+
+static void storageSync() {
+  logFile.flush();
+}
+
+static uint32_t storageSize() {
+  return logFile.size();
+}
+
+static uint8_t storageRead(uint32_t pos, uint8_t *b, uint16_t len) {
+  uint32_t end = logFile.position();
+  uint8_t ok = logFile.seek(pos) && (logFile.read(b, len) == len);
+
+  logFile.seek(end); //back to append position
+  return ok;
+}
+
+static void storageErase() {
+  logFile.close();
+  SD.remove((char *) LOG_FILE_NAME);
+  logFile = SD.open(LOG_FILE_NAME, FILE_WRITE);
+}
+
+/************** LOG ******************/
+
+uint8_t logInit() {
+  memset(logDecimation, 1, sizeof(logDecimation));
+  memset(logSkip, 0, sizeof(logSkip));
+  logHead = logTail = 0;
+  storageOk = storageBegin();
+  return storageOk;
+}
+
+void logStart() {
+  if (storageOk) logRunning = true;
+}
+
+/*
+ * stops appending and moves everything in the ring to storage
+ */
+void logStop() {
+  logRunning = false;
+  logFlush(true);
+  if (storageOk) storageSync();
+}
+
+uint8_t logIsRunning() {
+  return logRunning;
+}
+
+void logErase() {
+  logStop();
+  if (storageOk) storageErase();
+}
+
+void logSetDecimation(uint8_t esc, uint8_t n) {
+  if (esc >= MONITOR_MAX_ESCS) return;
+
+  uint8_t sreg = SREG;
+  cli();
+  logDecimation[esc] = (n == 0) ? 1 : n;
+  logSkip[esc] = 0;
+  SREG = sreg;
+}
+
+static inline uint16_t ringUsed(uint16_t head, uint16_t tail) {
+  return (head - tail) & LOG_RING_MASK;
+}
+
+/*
+ * called in ISR context (CastleLinkLive data available handler)
+ */
+void logAppend(uint8_t esc, CASTLE_RAW_DATA *data) {
+  if ( (! logRunning) || (esc >= MONITOR_MAX_ESCS) ) return;
+
+  if (logSkip[esc] > 0) {
+    logSkip[esc]--;
+    return;
+  }
+  logSkip[esc] = logDecimation[esc] - 1;
+
+  uint16_t head = logHead;
+  if (LOG_RING_MASK - ringUsed(head, logTail) < LOG_RECORD_SIZE) {
+    logDropCnt++;
+    return;
+  }
+
+  uint32_t ts = millis();
+  uint8_t rec[LOG_RECORD_SIZE];
+  uint8_t *p = rec;
+
+  *p++ = ts >> 24;
+  *p++ = ts >> 16;
+  *p++ = ts >> 8;
+  *p++ = ts & 0xFF;
+  *p++ = esc;
+  for (uint8_t f = 0; f < DATA_FRAME_CNT; f++) {
+    *p++ = data->ticks[f] >> 8;
+    *p++ = data->ticks[f] & 0xFF;
+  }
+
+  for (uint8_t i = 0; i < LOG_RECORD_SIZE; i++) {
+    logRing[head] = rec[i];
+    head = (head + 1) & LOG_RING_MASK;
+  }
+
+  logHead = head;
+}
+
+/*
+ * main context: moves ring content to storage, in at most two
+ * contiguous chunks. Unless all is set, waits for the ring to be half
+ * full, so that storage gets few large writes
+ */
+void logFlush(uint8_t all) {
+  uint16_t head;
+  uint8_t sreg = SREG;
+
+  cli();
+  head = logHead;
+  SREG = sreg;
+
+  uint16_t tail = logTail;
+  if (head == tail) return;
+  if ( (! all) && (ringUsed(head, tail) < LOG_RING_SIZE / 2) ) return;
+
+  if (storageOk) {
+    if (head < tail) { //wrapped: write up to ring end first
+      storageWrite(logRing + tail, LOG_RING_SIZE - tail);
+      tail = 0;
+    }
+    storageWrite(logRing + tail, head - tail);
+  }
+
+  cli();
+  logTail = head;
+  SREG = sreg;
+}
+
+uint32_t logRecords() {
+  if (! storageOk) return 0;
+  return storageSize() / LOG_RECORD_SIZE;
+}
+
+uint16_t logDropped() {
+  uint16_t ret;
+  uint8_t sreg = SREG;
+
+  cli();
+  ret = logDropCnt;
+  SREG = sreg;
+
+  return ret;
+}
+
+uint8_t logReadRecord(uint32_t index, LOG_RECORD *r) {
+  uint8_t rec[LOG_RECORD_SIZE];
+  uint8_t *p = rec + 5;
+
+  if ( (! storageOk) || (! storageRead(index * LOG_RECORD_SIZE, rec, LOG_RECORD_SIZE)) ) return false;
+
+  r->timestamp = ((uint32_t) rec[0] << 24) | ((uint32_t) rec[1] << 16) | ((uint32_t) rec[2] << 8) | rec[3];
+  r->esc = rec[4];
+  for (uint8_t f = 0; f < DATA_FRAME_CNT; f++, p += 2)
+    r->data.ticks[f] = (p[0] << 8) | p[1];
+
+  return true;
+}
+
+#endif
@@ -0,0 +1,75 @@
+/*****************************************************************************
+ *  CastleLinkLiveSerialMonitor - logger.h
+ *  Copyright (C) 2026  CastleLinkLive contributors
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  For further info, check http://code.google.com/p/castlelinklive4arduino/
+ *
+ *  SVN $Id$
+ *****************************************************************************/
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include "CastleLinkLive.h"
+
+/*
+ * on-device telemetry log: samples are appended by the data available
+ * handler (ISR context) to a RAM ring, which main loop moves to storage.
+ * Storage is a file on SD card: the SD library cache turns appends into
+ * 512 bytes sector writes. Another storage (i.e. SPI flash) only needs
+ * the storage* functions in logger.cpp
+ */
+
+// RAM ring size: must be a power of 2, max 32768
+#ifndef LOG_RING_SIZE
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+#define LOG_RING_SIZE 2048
+#else
+#define LOG_RING_SIZE 256
+#endif
+#endif
+
+#ifndef LOG_SD_CS_PIN
+#define LOG_SD_CS_PIN 10
+#endif
+
+#define LOG_FILE_NAME "CLL.LOG"
+
+/*
+ * record: timestamp (ms since boot, 4), ESC index (1), ticks (2 each),
+ * 16 bit values MSB first as in data frames
+ */
+#define LOG_RECORD_SIZE ( 4 + 1 + 2 * DATA_FRAME_CNT )
+
+typedef struct log_record_struct {
+  uint32_t timestamp;
+  uint8_t esc;
+  CASTLE_RAW_DATA data;
+} LOG_RECORD;
+
+uint8_t logInit();
+void logStart();
+void logStop();
+uint8_t logIsRunning();
+void logErase();
+void logSetDecimation(uint8_t esc, uint8_t n);
+void logAppend(uint8_t esc, CASTLE_RAW_DATA *data);
+void logFlush(uint8_t all);
+uint32_t logRecords();
+uint16_t logDropped();
+uint8_t logReadRecord(uint32_t index, LOG_RECORD *r);
+
+#endif
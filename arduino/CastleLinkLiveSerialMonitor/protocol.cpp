@@ -25,19 +25,75 @@
 #else
 #include "WProgram.h"
 #endif
+#include "config.h"
 #include "USART.h"
+#include "crc.h"
 #include "protocol.h"
 
-COMMAND cmdToProcess; //store for the to-be-processed command
-volatile uint8_t cmdProcessed = 1; //flag to indicate processed/still-to-process
+COMMAND cmdQueue[QUEUE_LEN]; //ring of to-be-processed commands
+volatile uint8_t cmdHead = 0; //next free slot: only moved by USART ISR
+volatile uint8_t cmdTail = 0; //oldest command: only moved by main context
+volatile uint16_t cmdOverflows = 0; //commands discarded because ring was full
+volatile uint16_t cmdChecksumErrors = 0; //commands discarded because of wrong checksum
+volatile uint8_t crcMode = CRCMODE_XOR; //frame and command check in use
+
+uint16_t checkUpdate(uint8_t mode, uint16_t check, uint8_t *b, uint8_t len) {
+  uint8_t *end = b + len;
+
+  switch (mode) {
+    case CRCMODE_CRC16:
+      while (b < end) check = crc16_update(check, *b++);
+      break;
+    case CRCMODE_CRC8:
+      while (b < end) check = crc8_update(check, *b++);
+      break;
+    default:
+      while (b < end) check ^= *b++;
+      break;
+  }
+
+  return check;
+}
+
+/*
+ * returns the first byte past the check
+ */
+uint8_t * putCheck(uint8_t mode, uint8_t *p, uint16_t check) {
+  if (mode == CRCMODE_CRC16) *p++ = check >> 8;
+  *p++ = check & 0xFF;
+  return p;
+}
 
 COMMAND * getNextCommand() {
-  //COMMAND *ret = NULL;
+  uart_poll(); //polled transports queue commands here
+
+  uint8_t tail = cmdTail;
 
-  if (! cmdProcessed) { //there's a command to process
-	  return &cmdToProcess;
+  if (tail != cmdHead) { //there's a command to process
+	  return &(cmdQueue[tail]);
   } else
 	  return NULL; //nothing to process
 }
 
+uint16_t getCommandOverflows() {
+  uint16_t ret;
+  uint8_t sreg = SREG;
+
+  cli();
+  ret = cmdOverflows;
+  SREG = sreg;
+
+  return ret;
+}
+
+uint16_t getCommandChecksumErrors() {
+  uint16_t ret;
+  uint8_t sreg = SREG;
+
+  cli();
+  ret = cmdChecksumErrors;
+  SREG = sreg;
+
+  return ret;
+}
 
@@ -25,6 +25,9 @@
 #define OUT_DATA_HEADER_H                  	0xFF
 #define OUT_DATA_HEADER_L                  	0xF0
 
+#define OUT_COMPACT_HEADER_H               	0xFC //compact frame: low header byte as OUT_DATA_HEADER_L
+#define OUT_BATCH_HEADER_H                 	0xFD //batch frame: low header byte as OUT_DATA_HEADER_L, ESC id unused
+
 #define ESC_ID_MASK                        	0x07 // 0000 0111
 #define THROTTLE_PRESENT                   	0x08 // 0000 1000
 
@@ -34,6 +37,30 @@
 #define R_ACK                       	0x01
 #define R_NACK                       0x00
 
+/*
+ * tagged commands: bits 5-7 of command id carry a tag from 1 to 7 chosen
+ * by the host, echoed in the response low header byte as
+ * OUT_TAGGED_RESPONSE_HEADER_L | tag << 1 | ACK/NACK bit. So the host can
+ * keep several commands in flight and match responses by tag.
+ * Commands with tag 0 get untagged responses
+ */
+#define CMD_ID_MASK                        	0x1F
+#define CMD_TAG_SHIFT                      	5
+#define OUT_TAGGED_RESPONSE_HEADER_L       	0xB0
+
+/*
+ * info frame: OUT_RESPONSE_HEADER_H, OUT_INFO_HEADER_L, info id,
+ * payload length, payload, XOR checksum of all previous bytes.
+ * Sent before the ACK of the command requesting it
+ */
+#define OUT_INFO_HEADER_L                  	0xA4
+#define INFO_STATS                         	0x01
+#define INFO_PROFILE                       	0x02 //isr, buckets count, latency and duration histograms
+#define INFO_COUNTERS                      	0x03 //samples sent, samples dropped (32 bit), command overflows, command checksum errors (16 bit), cycles completed (32 bit)
+#define INFO_LOG                           	0x04 //records stored (32 bit), records dropped (16 bit), running (8 bit)
+#define INFO_LOG_RECORD                    	0x05 //ESC index, timestamp (ms, 32 bit): precedes the full data frame of a dumped record
+#define INFO_VALUES                        	0x06 //ESC index, calibrated CASTLE_ESC_DATA_FX fields in struct order (16 bit, RPM 32 bit)
+
 #define CMD_HEADER 							0x00
 #define CMD_NOOP                           	0x00
 #define CMD_HELLO			   			   	0x01
@@ -45,8 +72,82 @@
 #define CMD_ARM				   				0x07
 #define CMD_SET_THROTTLE                   	0x08
 #define CMD_DISARM			   				0x09
+#define CMD_SET_DATAFMT		   				0x0A //l: DATAFMT_*, h: DATAFMT_SEQUENCED flag
+#define CMD_GET_STATS		   				0x0B //l: ESC index, h: STATS_READ_RESET flag
+#define CMD_RESET_STATS		   				0x0C //l: ESC index or STATS_ALL_ESCS
+#define CMD_GET_PROFILE		   				0x0D //l: CLL_PROF_* isr index, h: STATS_READ_RESET flag
+#define CMD_GET_COUNTERS	   				0x0E //free running counters: host computes deltas
+#define CMD_SET_TPERIOD		   				0x0F //generated throttle period (us)
+#define CMD_SET_BAUD		   				0x10 //l: BAUD_* code
+#define CMD_SET_CRC		   					0x11 //l: CRCMODE_*
+#define CMD_LOG			   					0x12 //l: LOG_* action
+#define CMD_SET_LOGDEC		   				0x13 //l: ESC index, h: log one sample every h
+/*
+ * calibration: CMD_CAL_SELECT picks an ESC data frame and resets its
+ * calibration to nominal, then CMD_CAL_GAIN and CMD_CAL_OFFSET set it.
+ * Calibration applies to the values of INFO_VALUES only: data frames
+ * always carry raw ticks
+ */
+#define CMD_CAL_SELECT		   				0x14 //l: ESC index, h: FRAME_* data frame
+#define CMD_CAL_GAIN		   				0x15 //gain of selected frame (CLL_CAL_GAIN_ONE is 1.0)
+#define CMD_CAL_OFFSET		   				0x16 //offset of selected frame (signed, CASTLE_ESC_DATA_FX units)
+#define CMD_GET_VALUES		   				0x17 //l: ESC index: answered with INFO_VALUES
+
+#define STATS_READ_RESET                      0x01 //reset stats after reading them
+#define STATS_ALL_ESCS                        0xFF
+
+#define DATAFMT_FULL                          0 //full 16 bit ticks for every frame
+#define DATAFMT_COMPACT                       1 //changed-frames bitmap + varint deltas
+#define DATAFMT_NONE                          2 //no data frames: host polls stats only
+#define DATAFMT_BATCH                         3 //all ESCs of a telemetry cycle in one frame
+
+/*
+ * sequenced frames: a sequence byte follows header (full and compact
+ * frames) or precedes ticks of each ESC (batch frames). It's the count
+ * of telemetry cycles completed for the ESC, so a gap means samples
+ * lost on the MCU (not read in time, or TX buffer full) or on the wire.
+ * Host can't tell which, so it drops compact deltas following a gap: the
+ * first compact frame sent after samples lost on the MCU is a keyframe
+ */
+#define DATAFMT_SEQUENCED                  0x01
 
 
+/*
+ * baud rate switch: ACK is sent at current rate, then the monitor
+ * switches and waits for a CMD_HELLO at the new rate. If it doesn't
+ * arrive within BAUD_CONFIRM_TIMEOUT ms, it goes back to the previous rate
+ */
+#define BAUD_38400                            0
+#define BAUD_250K                             1 //exact divisor at 8 and 16MHz
+#define BAUD_500K                             2
+#define BAUD_1M                               3
+#define BAUD_CONFIRM_TIMEOUT               1000
+
+/*
+ * check of frames (all but responses) and commands. With CRCMODE_XOR
+ * frames end with XOR of all previous bytes (batch frames with CRC-8),
+ * with CRCMODE_CRC8 with CRC-8 of all previous bytes, with CRCMODE_CRC16
+ * with CRC-16 (MSB first) of all previous bytes. Commands end with
+ * CRC-8 of id, l, h in both CRC modes. New mode applies to both directions
+ * after the ACK. CMD_HELLO is always accepted with XOR checksum too,
+ * as a new host doesn't know the mode in use, and it resets it to CRCMODE_XOR
+ */
+#define CRCMODE_XOR                           0
+#define CRCMODE_CRC8                          1
+#define CRCMODE_CRC16                         2
+#define CHECK_MAXSIZE                         2 //max bytes of frame check
+
+/*
+ * log actions. LOG_DUMP is ACKed first, then every stored record is
+ * sent as an INFO_LOG_RECORD info frame followed by a full data frame,
+ * then an INFO_LOG info frame marks the end
+ */
+#define LOG_STOP                              0
+#define LOG_START                             1
+#define LOG_ERASE                             2
+#define LOG_DUMP                              3
+#define LOG_STATUS                            4 //answered with INFO_LOG
+
 #define STATUS_HELLO                          0
 #define STATUS_CONF                           1
 #define STATUS_STARTED                        2
@@ -54,6 +155,22 @@
 
 #define OUT_DATA_BUFSIZE                      25
 
+/*
+ * compact frame: header (2), bitmap (2), up to 3 bytes varint per
+ * data frame, checksum (1). Bitmap bit N set means data frame N follows;
+ * COMPACT_KEYFRAME bit set means values are absolute ticks, otherwise
+ * they are zig-zag encoded deltas from previous frame of same ESC
+ */
+#define OUT_COMPACT_MAXSIZE                   ( 2 + 2 + 3 * DATA_FRAME_CNT + 1 )
+#define COMPACT_KEYFRAME                 0x8000
+#define COMPACT_KEYFRAME_INTERVAL            25 //send a keyframe at least every N frames
+
+/*
+ * batch frame: header (2), ESC mask (1), full ticks of every ESC in mask
+ * (lowest ESC first), CRC-8 (1) of all previous bytes
+ */
+#define OUT_BATCH_SIZE(N)                     ( 2 + 1 + 2 * DATA_FRAME_CNT * (N) + 1 )
+
 #define QUEUE_LEN 10
 
 typedef struct cmd_struct {
@@ -65,31 +182,89 @@ typedef struct cmd_struct {
 
 const size_t commandSize = sizeof(COMMAND);
 
-extern COMMAND cmdToProcess;
-extern volatile uint8_t cmdProcessed;
+/*
+ * zig-zag encoding maps small signed deltas to small unsigned values.
+ * v is shifted left as unsigned: shifting a negative int is undefined
+ */
+static inline uint16_t zigzag16(int16_t v) {
+	return (uint16_t) ( (uint16_t) ((uint16_t) v << 1) ^ (uint16_t) (v >> 15) );
+}
 
 /*
- * queueCommand is designed to be used in an ISR, so it's inlined and
- * checks for no other command waiting to be processed so to not interfere
- * with command processing code in main context.
- * Every command received while main context is busy processing a previous
- * command will be therefore discarded
+ * writes v as a little-endian base-128 varint (1 to 3 bytes):
+ * returns the first byte past the written ones
+ */
+static inline uint8_t * putVarint(uint8_t *p, uint16_t v) {
+	while (v >= 0x80) {
+		*p++ = (v & 0x7F) | 0x80;
+		v >>= 7;
+	}
+	*p++ = v;
+	return p;
+}
+
+extern volatile uint8_t crcMode;
+
+static inline uint16_t checkInit(uint8_t mode) {
+	return (mode == CRCMODE_CRC16) ? CRC16_INIT : 0;
+}
+
+static inline uint8_t checkSize(uint8_t mode) {
+	return (mode == CRCMODE_CRC16) ? 2 : 1;
+}
+
+static inline uint16_t checkByte(uint8_t mode, uint16_t check, uint8_t b) {
+	if (mode == CRCMODE_CRC16) return crc16_update(check, b);
+	if (mode == CRCMODE_CRC8) return crc8_update(check, b);
+	return check ^ b;
+}
+
+/*
+ * frame check, computed incrementally: start from checkInit(mode), add
+ * bytes with checkUpdate (or checkByte), then append it to the frame with putCheck
+ */
+uint16_t checkUpdate(uint8_t mode, uint16_t check, uint8_t *b, uint8_t len);
+uint8_t * putCheck(uint8_t mode, uint8_t *p, uint16_t check);
+
+extern COMMAND cmdQueue[QUEUE_LEN];
+extern volatile uint8_t cmdHead;
+extern volatile uint8_t cmdTail;
+extern volatile uint16_t cmdOverflows;
+extern volatile uint16_t cmdChecksumErrors;
+
+/*
+ * queueCommand is designed to be used in an ISR, so it's inlined.
+ * Commands are stored in a single-producer/single-consumer ring: the ISR
+ * only moves cmdHead and main context only moves cmdTail, so no locking
+ * is needed. The ring holds up to QUEUE_LEN - 1 commands: any command
+ * received while the ring is full is discarded and counted in cmdOverflows
  */
 static inline void queueCommand(char *buffer) {
-	if (cmdProcessed) {
-		memcpy((&cmdToProcess), buffer, commandSize); //copy command to command-to-process place
-		cmdProcessed = 0;
+	uint8_t head = cmdHead;
+	uint8_t next = head + 1;
+	if (next == QUEUE_LEN) next = 0;
+
+	if (next == cmdTail) { //ring full
+		cmdOverflows++;
+		return;
 	}
+
+	memcpy(&(cmdQueue[head]), buffer, commandSize); //copy command to its ring slot
+	cmdHead = next;
 }
 
 /*
- * signal main context is done with previous command and ready to process another one
+ * signal main context is done with current command: its slot
+ * is freed for the USART ISR
  */
 static inline void commandProcessed() {
-	cmdProcessed = 1;
+	uint8_t tail = cmdTail;
+	if (tail == cmdHead) return; //ring empty
+
+	if (++tail == QUEUE_LEN) tail = 0;
+	cmdTail = tail;
 }
 
 COMMAND * getNextCommand();
-
-
-
+uint16_t getCommandOverflows();
+uint16_t getCommandChecksumErrors();
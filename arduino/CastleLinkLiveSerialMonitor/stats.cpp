@@ -0,0 +1,101 @@
+/*****************************************************************************
+ *  CastleLinkLiveSerialMonitor - stats.cpp
+ *  Copyright (C) 2026  CastleLinkLive contributors
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  For further info, check http://code.google.com/p/castlelinklive4arduino/
+ *
+ *  SVN $Id$
+ *****************************************************************************/
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+#include "config.h"
+#include "stats.h"
+
+ESC_STATS stats[MONITOR_MAX_ESCS];
+
+void statsReset(uint8_t esc) {
+  ESC_STATS *s = &(stats[esc]);
+
+  s->count = 0;
+  for (uint8_t f = 0; f < DATA_FRAME_CNT; f++) {
+    s->min[f] = 0xFFFF;
+    s->max[f] = 0;
+    s->sum[f] = 0;
+    s->ewma[f] = 0;
+  }
+}
+
+void statsUpdate(uint8_t esc, CASTLE_RAW_DATA *data) {
+  ESC_STATS *s = &(stats[esc]);
+  boolean first = (s->count == 0);
+  boolean accumulate = (s->count < STATS_MAX_COUNT);
+
+  for (uint8_t f = 0; f < DATA_FRAME_CNT; f++) {
+    uint16_t t = data->ticks[f];
+    uint32_t x = ((uint32_t) t) << STATS_EWMA_FRAC;
+
+    if (t < s->min[f]) s->min[f] = t;
+    if (t > s->max[f]) s->max[f] = t;
+    if (accumulate) s->sum[f] += t;
+
+    if (first) //start EWMA from first sample instead of 0
+      s->ewma[f] = x;
+    else if (x > s->ewma[f])
+      s->ewma[f] += (x - s->ewma[f]) >> STATS_EWMA_SHIFT;
+    else
+      s->ewma[f] -= (s->ewma[f] - x) >> STATS_EWMA_SHIFT;
+  }
+
+  if (accumulate) s->count++;
+}
+
+static inline uint8_t * put16(uint8_t *p, uint16_t v) {
+  *p++ = v >> 8;
+  *p++ = v & 0xFF;
+  return p;
+}
+
+/*
+ * fills payload (STATS_PAYLOAD_SIZE bytes) with current stats for esc:
+ * returns payload length
+ */
+uint8_t statsPayload(uint8_t esc, uint8_t *payload) {
+  ESC_STATS *s = &(stats[esc]);
+  uint8_t *p = payload;
+
+  *p++ = esc;
+  p = put16(p, s->count);
+
+  for (uint8_t f = 0; f < DATA_FRAME_CNT; f++) {
+    if (s->count == 0) {
+      p = put16(p, 0);
+      p = put16(p, 0);
+      p = put16(p, 0);
+      p = put16(p, 0);
+    } else {
+      p = put16(p, s->min[f]);
+      p = put16(p, s->max[f]);
+      p = put16(p, (s->sum[f] + s->count / 2) / s->count);
+      p = put16(p, (s->ewma[f] + (1 << (STATS_EWMA_FRAC - 1))) >> STATS_EWMA_FRAC);
+    }
+  }
+
+  return p - payload;
+}
@@ -0,0 +1,62 @@
+/*****************************************************************************
+ *  CastleLinkLiveSerialMonitor - stats.h
+ *  Copyright (C) 2026  CastleLinkLive contributors
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  For further info, check http://code.google.com/p/castlelinklive4arduino/
+ *
+ *  SVN $Id$
+ *****************************************************************************/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "CastleLinkLive.h"
+
+// EWMA weight of a new sample is 1 / 2^STATS_EWMA_SHIFT
+#ifndef STATS_EWMA_SHIFT
+#define STATS_EWMA_SHIFT 3
+#endif
+
+// EWMA is kept in ticks with STATS_EWMA_FRAC fractional bits
+#define STATS_EWMA_FRAC 8
+
+// count (and sum) stop at this value: about 21 minutes at 50Hz
+#define STATS_MAX_COUNT 0xFFFF
+
+/*
+ * stats info payload: ESC index (1), samples count (2), then for each
+ * data frame min, max, mean, EWMA ticks (2 each). 16 bit values are
+ * sent MSB first as in data frames
+ */
+#define STATS_PAYLOAD_SIZE ( 1 + 2 + 4 * 2 * DATA_FRAME_CNT )
+
+/*
+ * running statistics of raw ticks for one ESC: all values are
+ * updated incrementally for every new telemetry sample
+ */
+typedef struct esc_stats_struct {
+  uint16_t count;
+  uint16_t min[DATA_FRAME_CNT];
+  uint16_t max[DATA_FRAME_CNT];
+  uint32_t sum[DATA_FRAME_CNT];
+  uint32_t ewma[DATA_FRAME_CNT];
+} ESC_STATS;
+
+void statsReset(uint8_t esc);
+void statsUpdate(uint8_t esc, CASTLE_RAW_DATA *data);
+uint8_t statsPayload(uint8_t esc, uint8_t *payload);
+
+#endif
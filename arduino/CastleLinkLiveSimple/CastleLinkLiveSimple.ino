@@ -261,13 +261,13 @@ void loop() {
     CASTLE_ESC_DATA escHR;
 
     if (rawData) {
-      if (CastleLinkLive.getData(0, &escRaw)) {
+      if (CastleLinkLive.getDataIfNew(0, &escRaw)) {
         Serial.println(" ");
         print_data(&escRaw);
       } else
         Serial.println(" No data");
     } else {
-      if (CastleLinkLive.getData(0, &escHR)) {
+      if (CastleLinkLive.getDataIfNew(0, &escHR)) {
         Serial.println(" ");
         print_data(&escHR);
       } else
@@ -50,6 +50,10 @@
 #include "WProgram.h"
 #endif
 
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <avr/power.h>
+
 #include "CastleLinkLive_config.h"
 #include "CastleLinkLive.h"
 
@@ -66,6 +70,13 @@
 #error "MCU not supported"
 #endif
 
+// power reduction register holding PRADC
+#ifdef PRR0
+#define ADC_PRR PRR0
+#else
+#define ADC_PRR PRR
+#endif
+
 /***************************************
  * TIMER macros
  ***************************************/
@@ -89,15 +100,27 @@
 
 #define TG_INTERVAL ( TG_MAX - TG_MIN )
 
-#define TG_PERIOD_TICKS (THROTTLEGEN_PERIOD * TIMER_FREQ) //20ms period
+#define TICKS_PER_US (TIMER_FREQ / 1000000)
+
+#define THROTTLEGEN_PERIOD_US ( (uint16_t) (THROTTLEGEN_PERIOD * 1000000.0f) )
 
 #define CASTLE_RESET_TIMEOUT 0.006f //6 ms: castle tick has to come before
 #define TIMER_RESET_TICKS (CASTLE_RESET_TIMEOUT * TIMER_FREQ)
 
+// generated throttle period bounds (us): after pulse end the telemetry window
+// (CASTLE_RESET_TIMEOUT) must elapse, plus a margin for COMPA ISR to restore
+// ESC pins, before next pulse starts; timer must not overflow within a period
+#define CASTLE_RESET_TIMEOUT_US 6000u
+#define THROTTLEGEN_MARGIN_US 500u
+#define THROTTLEGEN_MIN_PERIOD_US(TMAX) ( (uint32_t) (TMAX) + CASTLE_RESET_TIMEOUT_US + THROTTLEGEN_MARGIN_US )
+#define THROTTLEGEN_MAX_PERIOD_US ( TIMER_RESOLUTION / TICKS_PER_US )
+
+#define FRAME_CYCLE ( DATA_FRAME_CNT + 1 ) //throttle frames in a telemetry cycle: data frames and reset frame
+#define FRAME_UNSYNCED DATA_FRAME_CNT //frameIdx while waiting for a reset frame: ticks are ignored
+
 #define THROTTLE_SIGNAL_TIMEOUT 1.0f //1 sec timeout from RX
+#define THROTTLE_SIGNAL_TIMEOUT_US 1000000UL
 #define MAX_OVERFLOW ( THROTTLE_SIGNAL_TIMEOUT / ( ((float) TIMER_RESOLUTION) / ((float) TIMER_FREQ)) )
-#define MAX_NO_THROTTLE_GEN ( THROTTLE_SIGNAL_TIMEOUT / THROTTLEGEN_PERIOD )
-#define WAITFORDATA_TIMEOUT ( THROTTLE_SIGNAL_TIMEOUT * 500) //throttle signal timeout / 2 * 1000
 
 #define THROTTLE_PRESENCE_FLAG   0x80
 
@@ -105,9 +128,140 @@
 #define SET_THROTTLE_NOT_PRESENT() ( flags &= ~ THROTTLE_PRESENCE_FLAG )
 #define IS_THROTTLE_PRESENT() ( flags & THROTTLE_PRESENCE_FLAG )
 
+// lock-free reads: ticks buffers aren't volatile, so keep the compiler
+// from moving their loads across the volatile sequence reads
+#define COMPILER_BARRIER() __asm__ __volatile__ ("" ::: "memory")
+
 #define LED_MIN_MOD 100
 #define LED_MAX_MOD 1
 
+/***************************************
+ * Compile-time specialisation macros
+ ***************************************/
+#if (CLL_STATIC_NESC > MAX_ESCS)
+#error "CLL_STATIC_NESC exceeds the number of ESCs supported by this MCU"
+#endif
+
+#if (CLL_ESC0_CAPTURE != 0)
+#ifndef ESC_CAPTURE_ISR
+#error "ESC0 input capture is not supported on this MCU"
+#endif
+#if defined(__AVR_ATmega32U4__) && (LED_DISABLE == 0)
+#error "ESC0 input capture on ATmega32U4 shares the led pin: set LED_DISABLE"
+#endif
+// ESC0 is timestamped by input capture: don't enable its external interrupt
+#define escIntEnableMask(N) ( (uint8_t) (getEscIntEnableMask(N) & ~ ESC_CAPTURE_INT_MASK) )
+#define CAPTURE_START() ESC_CAPTURE_ENABLE()
+#define CAPTURE_STOP() ESC_CAPTURE_DISABLE()
+#else
+#define escIntEnableMask(N) getEscIntEnableMask(N)
+#define CAPTURE_START()
+#define CAPTURE_STOP()
+#endif
+
+#if (CLL_STATIC_NESC > 0)
+#define ESC_PINS_HIGH_MASK getEscPinsMask(CLL_STATIC_NESC)
+#define ESC_PINS_LOW_MASK ( (uint8_t) ~ getEscPinsMask(CLL_STATIC_NESC) )
+#define EXT_INT_CLEAR_MASK getEscIntClearMask(CLL_STATIC_NESC)
+#define EXT_INT_ENABLE_MASK escIntEnableMask(CLL_STATIC_NESC)
+#define EXT_INT_DISABLE_MASK ( (uint8_t) ~ escIntEnableMask(CLL_STATIC_NESC) )
+#else
+#define ESC_PINS_HIGH_MASK escPinsHighMask
+#define ESC_PINS_LOW_MASK escPinsLowMask
+#define EXT_INT_CLEAR_MASK extIntClearMask
+#define EXT_INT_ENABLE_MASK extIntEnableMask
+#define EXT_INT_DISABLE_MASK extIntDisableMask
+#endif
+
+// PCINT ESC channels are not needed with a static number of ESCs all on INTn
+#if defined(ESCX_ISR) && (CLL_STATIC_NESC > 0) && (CLL_STATIC_NESC <= ESCX_FIRST)
+#undef ESCX_ISR
+#endif
+
+#ifdef ESCX_ISR
+#if (CLL_STATIC_NESC > 0)
+#define ESCX_PINS_HIGH_MASK getEscxPinsMask(CLL_STATIC_NESC)
+#else
+#define ESCX_PINS_HIGH_MASK escxPinsHighMask
+#endif
+#define ESCX_PINS_LOW_MASK ( (uint8_t) ~ ESCX_PINS_HIGH_MASK )
+#define ESCX_WRITE_LOW() ( ESCX_WRITE_PORT &= ESCX_PINS_LOW_MASK )
+#define ESCX_WRITE_HIGH() ( ESCX_WRITE_PORT |= ESCX_PINS_HIGH_MASK )
+#define ESCX_SET_INPUT() ( ESCX_DDR &= ESCX_PINS_LOW_MASK )
+#define ESCX_SET_OUTPUT() ( ESCX_DDR |= ESCX_PINS_HIGH_MASK )
+// lines are high (pulled-up) when switched to input: only falling edges from now on are ticks
+#define ESCX_START() ( escxLastPins = ESCX_PINS_HIGH_MASK, ESCX_INT_ENABLE() )
+#define ESCX_STOP() ESCX_INT_DISABLE()
+#else
+#define ESCX_WRITE_LOW()
+#define ESCX_WRITE_HIGH()
+#define ESCX_SET_INPUT()
+#define ESCX_SET_OUTPUT()
+#define ESCX_START()
+#define ESCX_STOP()
+#endif
+
+#define THROTTLE_MIN_US ( (uint16_t) (THROTTLE_MIN * 1000000.0f) )
+#define THROTTLE_MAX_US ( (uint16_t) (THROTTLE_MAX * 1000000.0f) )
+
+#if (CLL_STATIC_THROTTLE == CLL_THROTTLE_EXTERNAL)
+#define THROTTLE_MIN_TICKS ( (uint16_t) (THROTTLE_MIN_US * (TIMER_FREQ / 1000000)) )
+#define THROTTLE_INTERVAL_TICKS ( (uint16_t) ((THROTTLE_MAX_US - THROTTLE_MIN_US) * (TIMER_FREQ / 1000000)) )
+// 100 / THROTTLE_INTERVAL_TICKS in Q16 for led modulus calculation
+#define LED_SCALE_Q16 ( (uint32_t) (100UL * 65536UL / THROTTLE_INTERVAL_TICKS) )
+#else
+#define THROTTLE_MIN_TICKS _throttleMinTicks
+#define THROTTLE_INTERVAL_TICKS _throttleIntervalTicks
+#define LED_SCALE_Q16 _ledScaleQ16
+#endif
+
+/***************************************
+ * Profiling macros
+ ***************************************/
+#if (CLL_PROFILE != 0)
+// low 16 bits of the 32 bit timebase: differences stay valid across timer clears
+#define PROF_NOW16() ( (uint16_t) profEpoch + TIMER_CNT )
+// timer clear in ISRs: accumulate elapsed ticks into the timebase
+#define ISR_TIMER_CLEAR() ( profEpoch += TIMER_CNT, TIMER_CLEAR() )
+#define PROF_ENTER() uint16_t profT0 = PROF_NOW16()
+#define PROF_LATENCY(I, T) profRecord(prof[I].latency, (T))
+#define PROF_EXIT(I) profRecord(prof[I].duration, PROF_NOW16() - profT0)
+#define PROF_OVERFLOW() ( profEpoch += TIMER_RESOLUTION + 1UL )
+#else
+#define ISR_TIMER_CLEAR() TIMER_CLEAR()
+#define PROF_ENTER()
+#define PROF_LATENCY(I, T)
+#define PROF_EXIT(I)
+#define PROF_OVERFLOW()
+#endif
+
+/***************************************
+ * Free running timer macros
+ ***************************************/
+#if (CLL_FREE_RUNNING_TIMER != 0)
+#if (CLL_TIMER_SLOTS < 1) || (CLL_TIMER_SLOTS > 8)
+#error "CLL_TIMER_SLOTS must be from 1 to 8"
+#endif
+// throttle edge at timer count T: ticks and telemetry window are timed from it
+#define THROTTLE_EDGE(T) ( edgeTime = (T), TIMER_SET_COMPA( (uint16_t) ((T) + (uint16_t) TIMER_RESET_TICKS) ) )
+#define EDGE_ELAPSED(T) ( (uint16_t) ((T) - edgeTime) )
+#define GEN_PULSE_END() THROTTLE_EDGE(TIMER_CNT)
+#define GEN_NEXT(T) ( genDue += (T) )
+#define GEN_STOP() ( generating = false )
+#define IS_ARMED() ( armed )
+#define SLOT_NONE 0xFF
+// callbacks scheduled from main context are due at least this late, so
+// that compare unit B is programmed before the counter gets there
+#define TIMER_MIN_AHEAD ( 16 * TICKS_PER_US )
+#else
+#define THROTTLE_EDGE(T) ( (void) (T), ISR_TIMER_CLEAR() )
+#define EDGE_ELAPSED(T) (T)
+#define GEN_PULSE_END()
+#define GEN_NEXT(T) TIMER_SET_COMPB(T)
+#define GEN_STOP() TIMER_DISABLE_COMPB()
+#define IS_ARMED() TIMER_IS_RUNNING()
+#endif
+
 //definitions from pins_arduino.c
 #define PA 1
 #define PB 2
@@ -123,7 +277,17 @@
 
 /** \cond skipthis */
 typedef struct castle_priv_data_struct {
-   uint16_t ticks[DATA_FRAME_CNT];
+   // ping-pong buffers: INTn ISRs fill ticks[fill], ticks[fill ^ 1] holds
+   // the last complete frame set published by COMPA ISR
+   uint16_t ticks[2][DATA_FRAME_CNT];
+   volatile uint8_t fill;
+
+   // incremented by COMPA ISR at every publish, never 0 once published
+   volatile uint8_t seq;
+   // last seq returned to main context by getData/getDataIfNew
+   uint8_t readSeq;
+   // last seq reported as CLL_EVENT_DATA by sleepUntilEvent
+   uint8_t wakeSeq;
 
    int frameIdx;
    uint8_t ticked;
@@ -133,6 +297,9 @@ typedef struct castle_priv_data_struct {
 
 CASTLE_PRIV_DATA data[MAX_ESCS];
 
+// incremented by COMPA ISR whenever any ESC publishes a sample
+volatile uint8_t publishCnt = 0;
+
 volatile uint8_t flags = 0; 
 
 uint8_t throttleFailCnt = 0;
@@ -154,13 +321,135 @@ uint8_t extIntClearMask;
 uint8_t extIntEnableMask;
 uint8_t extIntDisableMask;
 
+#ifdef ESCX_ISR
+uint8_t escxPinsHighMask;
+uint8_t escxLastPins; //PCINT ESC pins at last pin change
+#endif
+
 uint16_t _throttleMinTicks;
 uint16_t _throttleMaxTicks;
 uint16_t _throttleIntervalTicks;
 
+// THROTTLE_INTERVAL_TICKS / 100 in Q16: generated pulse ticks per throttle step
+uint32_t _throttleStepQ16;
+// 100 / THROTTLE_INTERVAL_TICKS in Q16 for led modulus calculation
+uint32_t _ledScaleQ16;
+
+uint16_t _throttlePeriodTicks;
+uint8_t _maxNoThrottleGen;
+
+// decimated telemetry: after a burst of listened frames giving a sample
+// for every ESC, skip listenSkipFrames frames keeping ESC pins as outputs
+uint16_t listenSkipFrames;
+uint16_t skipCnt; //frames left to relay without listening
+uint8_t burstFrames; //frames listened in current burst
+uint8_t burstMask; //ESCs which published a sample in current burst
+uint8_t installedEscMask;
+uint8_t listening; //telemetry window opened after current throttle pulse
+
+#if (CLL_PROFILE != 0)
+volatile uint32_t profEpoch;
+CLL_PROFILE_DATA prof[CLL_PROF_CNT];
+
+// log2 bucket: 0 for 0 ticks, n for 2^(n-1) to 2^n - 1 ticks
+inline void profRecord(uint16_t *h, uint16_t t) {
+  uint8_t b = 0;
+
+  while (t) {
+    b++;
+    t >>= 1;
+  }
+
+  if (b >= CLL_PROF_BUCKETS) b = CLL_PROF_BUCKETS - 1;
+  if (h[b] != 0xFFFF) h[b]++;
+}
+#endif
+
+#if (CLL_BENCHMARK != 0)
+uint8_t benchSlot[MAX_ESCS]; //next frame to tick in, DATA_FRAME_CNT for reset frame
+uint8_t benchSample;
+#endif
+
 void (*throttlePresenceHandler) (uint8_t) = NULL;
 void (*dataAvailableHandler) (uint8_t escIndex, CASTLE_RAW_DATA *data) = NULL;
 
+#if (CLL_DEFERRED_HANDLERS != 0)
+// bit N set by COMPA ISR when ESC N published a sample, cleared by poll()
+volatile uint8_t handlersPendingMask = 0;
+#endif
+
+/*
+ * calibration folded with nominal scales: a value is
+ * ((base * mul) >> shift) + offset. mul is normalized below 2^15,
+ * so that the product with a base value (below 2^17) fits 32 bits.
+ * FRAME_TEMP2 multiplier applies to the table output instead of base
+ */
+typedef struct cll_cal_data_struct {
+  uint16_t mul[CLL_CAL_CNT];
+  uint8_t shift[CLL_CAL_CNT];
+  int16_t offset[CLL_CAL_CNT];
+} CLL_CAL_DATA;
+
+CLL_CAL_DATA calData[MAX_ESCS];
+uint8_t calibratedMask = 0; //ESCs with a non-nominal profile
+
+#if (CLL_FREE_RUNNING_TIMER != 0)
+uint16_t edgeTime; //timer count at last throttle edge
+uint8_t armed = false;
+uint8_t externalThrottle; //OVF ISR times out external throttle only
+// compare unit B scheduler: generated throttle edge and callback slots
+volatile uint8_t generating = false;
+uint16_t genDue;
+uint16_t slotDue[CLL_TIMER_SLOTS];
+void (*slotCallback[CLL_TIMER_SLOTS]) (uint8_t slot);
+uint8_t slotMask = 0; //slots with a pending callback
+uint8_t slotRunning = SLOT_NONE; //slot whose callback is running
+
+/*
+ * programs compare unit B for the nearest pending event. Every pending
+ * event must be due within TIMER_RESOLUTION ticks from ref, a time not
+ * later than now. Returns false if that event is already due: caller has
+ * to run it, and clear the match flag the counter may have set meanwhile
+ */
+static uint8_t schedProgram(uint16_t ref) {
+  uint16_t ahead = TIMER_RESOLUTION;
+  uint8_t pending = generating;
+
+  if (generating) ahead = genDue - ref;
+
+  for (uint8_t s = 0; s < CLL_TIMER_SLOTS; s++) {
+    if (! (slotMask & _BV(s)) ) continue;
+
+    uint16_t a = slotDue[s] - ref;
+    if ( (! pending) || (a < ahead) ) ahead = a;
+    pending = true;
+  }
+
+  if (! pending) {
+    TIMER_DISABLE_COMPB();
+    return true;
+  }
+
+  TIMER_SET_COMPB(ref + ahead);
+  if (! TIMER_IS_COMPB_ENABLED() ) {
+    TIMER_CLEAR_COMPB_PENDING(); //stale match
+    TIMER_ENABLE_COMPB();
+  }
+
+  return ( (uint16_t) (TIMER_CNT - ref) < ahead );
+}
+
+/*
+ * reprograms compare unit B from main context, with interrupts disabled.
+ * If a match is pending, COMPB ISR will do it; otherwise every pending
+ * event is due later than now
+ */
+static void schedKick() {
+  if ( TIMER_IS_COMPB_ENABLED() && TIMER_IS_COMPB_PENDING() ) return;
+  schedProgram(TIMER_CNT);
+}
+#endif
+
 
 /* 
  * CastleLinkLiveLib class
@@ -177,6 +466,8 @@ void CastleLinkLiveLib::init() {
   _timer_init();
   _throttlePinNumber = GENERATE_THROTTLE;
   //_nESC = 0;
+
+  for (uint8_t i = 0; i < MAX_ESCS; i++) setCalibration(i, NULL);
   
   LED_INIT();
   LED_OFF();    
@@ -189,27 +480,56 @@ void CastleLinkLiveLib::_init_data_structure(int i) {
   data[i].frameIdx = FRAME_RESET;
   data[i].ready = 0;
   data[i].ticked = 0;
-  for (int j = 0; j < DATA_FRAME_CNT; j++)
-    data[i].ticks[j] = 0;
+  data[i].fill = 0;
+  data[i].seq = 0;
+  data[i].readSeq = 0;
+  data[i].wakeSeq = 0;
+  memset(data[i].ticks, 0, sizeof(data[i].ticks));
 }
 
 /*
  * Inits 16bit TIMER1
  */
 void CastleLinkLiveLib::_timer_init() {
+#if (CLL_FREE_RUNNING_TIMER != 0)
+  // normal mode, but the counter may be shared: only stop using it
+  TIMER_INIT();
+  TIMER_DISABLE_COMPA();
+#if (CLL_PROFILE != 0)
+  TIMER_CLEAR_OVF_PENDING();
+  TIMER_ENABLE_OVF(); //profiling timebase counts every wrap, armed or not
+#else
+  TIMER_DISABLE_OVF();
+#endif
+  armed = false;
+  generating = false;
+  schedProgram(TIMER_CNT);
+#else
   // stop timer and set normal mode
   TIMER_STOP();
   TIMER_INIT();
   TIMER_CLEAR();
+#endif
+#if (CLL_PROFILE != 0)
+  profEpoch = 0;
+#endif
 }
 
 
 uint8_t CastleLinkLiveLib::_setThrottlePinRegisters() {
   _pcicr = &PCICR;
+
+#if (CLL_ESC0_CAPTURE != 0)
+  if (_throttlePinNumber == ESC_CAPTURE_PIN) return false; //wired to ESC0
+#endif
   
   uint8_t port = digitalPinToPort(_throttlePinNumber);
   
   if (port == NOT_A_PORT) return false;
+
+#ifdef ESCX_ISR
+  if (port == ESCX_THROTTLE_PORT) return false; //pin change interrupt used by ESCs
+#endif
   
 #if defined (__AVR_ATmega32U4__)
   if (port != PB) return false; //on ATmega32U4 we have PCINT only on PORTB
@@ -293,18 +613,36 @@ uint8_t CastleLinkLiveLib::_setThrottlePinRegisters() {
   return true;
 }
 
-uint8_t CastleLinkLiveLib::_copyDataStructure(uint8_t index, CASTLE_RAW_DATA *dest) {
-  
-  const uint8_t mask = _BV(index);
-  flags |= mask; //set busy flag for desired ESC
+uint8_t CastleLinkLiveLib::_snapshotDataStructure(uint8_t index, CASTLE_RAW_DATA *dest) {
+  CASTLE_PRIV_DATA *d = &(data[index]);
+  uint8_t seq;
+
+  // lock-free read: COMPA ISR may publish a new frame set while we copy,
+  // in that case seq changes and we simply copy the newer one
+  do {
+    seq = d->seq;
+    COMPILER_BARRIER();
+    memcpy(dest, d->ticks[d->fill ^ 1], sizeof(uint16_t) * DATA_FRAME_CNT);
+    COMPILER_BARRIER();
+  } while (seq != d->seq);
+
+  return seq;
+}
 
-  unsigned long startWait = millis();
-  while (flags & mask) { //wait for ISRs code to finish filling data structure
-	if (millis() - startWait >= WAITFORDATA_TIMEOUT) return false;
+uint8_t CastleLinkLiveLib::_copyDataStructure(uint8_t index, CASTLE_RAW_DATA *dest, uint8_t *seqOut) {
+  CASTLE_PRIV_DATA *d = &(data[index]);
+  uint8_t seq = _snapshotDataStructure(index, dest);
+
+  if (seq == 0) return false; //nothing published yet
+
+  if (seqOut) *seqOut = seq;
+
+  if (seq == d->readSeq) {
+    return CLL_DATA_OLD;
+  } else {
+    d->readSeq = seq;
+    return CLL_DATA_NEW;
   }
-  memcpy(dest, &(data[index]), sizeof(uint16_t) * DATA_FRAME_CNT); 
-  
-  return true;
 }
 
 /* 
@@ -312,7 +650,7 @@ uint8_t CastleLinkLiveLib::_copyDataStructure(uint8_t index, CASTLE_RAW_DATA *de
  *****************************************************/
 #if (LED_DISABLE == 0)
 void CastleLinkLiveLib::setLed(uint8_t on) {
-  if ( TIMER_IS_RUNNING() ) return;
+  if ( IS_ARMED() ) return;
   
   if (on)
    LED_ON();
@@ -321,8 +659,28 @@ void CastleLinkLiveLib::setLed(uint8_t on) {
 }
 #endif
  
-uint8_t CastleLinkLiveLib::begin(uint8_t nESC, int throttlePinNumber, uint16_t throttleMin, uint16_t throttleMax) {
+uint8_t CastleLinkLiveLib::begin(uint8_t nESC, int throttlePinNumber, uint16_t throttleMin, uint16_t throttleMax, uint16_t framePeriod, uint8_t listenCycles) {
   if ( (nESC > MAX_ESCS) || (nESC <= 0) ) return false;
+
+  if (listenCycles == 0) return false;
+
+  if (throttlePinNumber == GENERATE_THROTTLE) {
+    if ( (framePeriod < THROTTLEGEN_MIN_PERIOD_US(throttleMax)) || (framePeriod > THROTTLEGEN_MAX_PERIOD_US) ) return false;
+  }
+
+#if (CLL_STATIC_NESC > 0)
+  if (nESC != CLL_STATIC_NESC) return false;
+#endif
+
+#if (CLL_STATIC_THROTTLE == CLL_THROTTLE_GENERATE)
+  if (throttlePinNumber != GENERATE_THROTTLE) return false;
+#elif (CLL_STATIC_THROTTLE == CLL_THROTTLE_EXTERNAL)
+  if (throttlePinNumber == GENERATE_THROTTLE) return false;
+#endif
+
+#if (CLL_STATIC_THROTTLE != CLL_THROTTLE_RUNTIME)
+  if ( (throttleMin != THROTTLE_MIN_US) || (throttleMax != THROTTLE_MAX_US) ) return false;
+#endif
   
   gInstalledEsc = nESC;
 
@@ -346,32 +704,74 @@ uint8_t CastleLinkLiveLib::begin(uint8_t nESC, int throttlePinNumber, uint16_t t
   escPinsLowMask = ~ escPinsHighMask;
 
   extIntClearMask = getEscIntClearMask(nESC);
-  extIntEnableMask = getEscIntEnableMask(nESC);
+  extIntEnableMask = escIntEnableMask(nESC);
   extIntDisableMask = ~ extIntEnableMask;
 
   ESC_DDR |= escPinsHighMask; //set ESCs pins as outputs
   ESC_WRITE_PORT |= escPinsHighMask; //set ESCs pins high
 
+#ifdef ESCX_ISR
+  escxPinsHighMask = getEscxPinsMask(nESC);
+  ESCX_SET_OUTPUT();
+  ESCX_WRITE_HIGH();
+  ESCX_PCMSK = escxPinsHighMask; //ESC pins generate pin change interrupt when enabled
+#endif
+
+#if (CLL_ESC0_CAPTURE != 0)
+  ESC_CAPTURE_INIT();
+#endif
+
+#if (CLL_FREE_RUNNING_TIMER == 0)
   // set output compare match A of timer1 with number of ticks
   // corresponding to CASTLE_RESET_TIMEOUT
   TIMER_SET_COMPA (TIMER_RESET_TICKS);
 
   // enable output compare match A interrupt generation
   TIMER_ENABLE_COMPA();
+#else
+  cli();
+  externalThrottle = (_throttlePinNumber != GENERATE_THROTTLE); //compare interrupts are enabled by throttleArm
+  if (externalThrottle && (! TIMER_IS_OVF_ENABLED()) ) { //OVF ISR times out external throttle only when armed
+    TIMER_CLEAR_OVF_PENDING();
+    TIMER_ENABLE_OVF();
+  }
+  sei();
+#endif
 
   //init data structures
   for (int i = 0; i < nESC; i++) _init_data_structure(i);
 
+  installedEscMask = (uint8_t) (_BV(nESC) - 1);
+  // skipping a whole number of cycles but one frame, listening restarts on
+  // the reset frame of the ESC completing the burst
+  listenSkipFrames = (listenCycles > 1) ? FRAME_CYCLE * (listenCycles - 1) - 1 : 0;
+  skipCnt = 0;
+  burstFrames = 0;
+  burstMask = 0;
+  listening = false;
+
+#if (CLL_BENCHMARK != 0)
+  memset(benchSlot, 0, sizeof(benchSlot));
+#endif
+
   if (_throttlePinNumber == GENERATE_THROTTLE) { // if auto-generating throttle...
+    _throttlePeriodTicks = framePeriod * TICKS_PER_US;
+    // throttle failure after THROTTLE_SIGNAL_TIMEOUT without setThrottle calls
+    _maxNoThrottleGen = THROTTLE_SIGNAL_TIMEOUT_US / framePeriod;
+
+#if (CLL_FREE_RUNNING_TIMER == 0)
     // set output compare match B with number of ticks
-    // corresponding to TG_PERIOD
-	  TIMER_SET_COMPB (TG_PERIOD_TICKS);
+    // corresponding to frame period
+	  TIMER_SET_COMPB (_throttlePeriodTicks);
 
 	  TIMER_ENABLE_COMPB(); //enable output compare match B interrupt generation
+#endif
     
   } else {
     *_throttlePortModeReg &= ~ ( throttlePinMask ); //set throttle pin as input
+#if (CLL_FREE_RUNNING_TIMER == 0)
     TIMER_ENABLE_OVF(); //enable timer overflow interrupt
+#endif
   }
 
   /* 
@@ -383,6 +783,8 @@ uint8_t CastleLinkLiveLib::begin(uint8_t nESC, int throttlePinNumber, uint16_t t
   _throttleMinTicks = throttleMin * (TIMER_FREQ / 1000000);
   _throttleMaxTicks = throttleMax * (TIMER_FREQ / 1000000);
   _throttleIntervalTicks = (throttleMax - throttleMin) * (TIMER_FREQ / 1000000);
+  _throttleStepQ16 = ( ((uint32_t) _throttleIntervalTicks << 16) + 50 ) / 100;
+  _ledScaleQ16 = _throttleIntervalTicks ? (100UL << 16) / _throttleIntervalTicks : 0;
   
 
   sei(); //ready to go: enable interrupts
@@ -390,19 +792,43 @@ uint8_t CastleLinkLiveLib::begin(uint8_t nESC, int throttlePinNumber, uint16_t t
   
 }
 
+uint8_t CastleLinkLiveLib::begin(uint8_t nESC, int throttlePinNumber, uint16_t throttleMin, uint16_t throttleMax, uint16_t framePeriod, uint8_t listenCycles, const CASTLE_CALIBRATION *cal) {
+  if (! begin(nESC, throttlePinNumber, throttleMin, throttleMax, framePeriod, listenCycles)) return false;
+
+  if (cal) {
+    for (uint8_t i = 0; i < nESC; i++) setCalibration(i, &(cal[i]));
+  }
+
+  return true;
+}
+
+uint8_t CastleLinkLiveLib::begin(uint8_t nESC, int throttlePinNumber, uint16_t throttleMin, uint16_t throttleMax, uint16_t framePeriod) {
+  return begin(nESC, throttlePinNumber, throttleMin, throttleMax, framePeriod, 1);
+}
+
+uint8_t CastleLinkLiveLib::begin(uint8_t nESC, int throttlePinNumber, uint16_t throttleMin, uint16_t throttleMax) {
+  return begin(nESC, throttlePinNumber, throttleMin, throttleMax, THROTTLEGEN_PERIOD_US);
+}
+
 uint8_t CastleLinkLiveLib::begin(uint8_t nESC, int throttlePinNumber) {
-  return begin(nESC, throttlePinNumber, THROTTLE_MIN * 1000000.0f, THROTTLE_MAX * 1000000.0f);  
+  return begin(nESC, throttlePinNumber, THROTTLE_MIN_US, THROTTLE_MAX_US);  
 }
 uint8_t CastleLinkLiveLib::begin(uint8_t nESC) {
-  return begin(nESC, GENERATE_THROTTLE, THROTTLE_MIN * 1000000.0f, THROTTLE_MAX * 1000000.0f);
+  return begin(nESC, GENERATE_THROTTLE, THROTTLE_MIN_US, THROTTLE_MAX_US);
 }
 
 uint8_t CastleLinkLiveLib::begin() {
-  return begin(1, GENERATE_THROTTLE, THROTTLE_MIN * 1000000.0f, THROTTLE_MAX * 1000000.0f);
+  return begin(1, GENERATE_THROTTLE, THROTTLE_MIN_US, THROTTLE_MAX_US);
 }
 
 void CastleLinkLiveLib::throttleArm() {
   cli();
+
+#if (CLL_FREE_RUNNING_TIMER != 0)
+  armed = true;
+  TIMER_CLEAR_COMPA_PENDING();
+  TIMER_ENABLE_COMPA();
+#endif
   
   if (_throttlePinNumber == GENERATE_THROTTLE) {
     SET_THROTTLE_PRESENT();
@@ -410,7 +836,7 @@ void CastleLinkLiveLib::throttleArm() {
     SET_THROTTLE_NOT_PRESENT();    
   } else {
     *_pcmsk = _BV(_pcint); //enable throttle pin to generate port-interrupt
-    *_pcicr = _BV(_pcie); //enable throttle pin port to generate interrupt    
+    *_pcicr |= _BV(_pcie); //enable throttle pin port to generate interrupt    
   }
   
   SET_THROTTLE_NOT_PRESENT();
@@ -421,7 +847,19 @@ void CastleLinkLiveLib::throttleArm() {
 
 void CastleLinkLiveLib::throttleDisarm() {
   cli();
+#if (CLL_FREE_RUNNING_TIMER != 0)
+  // timer keeps running for other code and timer callbacks
+  armed = false;
+  generating = false;
+  listening = false;
+  TIMER_DISABLE_COMPA(); //OVF stays enabled: profiling timebase keeps counting wraps
+  EIMSK &= EXT_INT_DISABLE_MASK;
+  schedKick();
+#else
   TIMER_STOP();
+#endif
+  CAPTURE_STOP();
+  ESCX_STOP();
 
   if (_throttlePinNumber != GENERATE_THROTTLE) {
     *_pcmsk &= ~ _BV(_pcint); //disable throttle pin port-interrupt generation
@@ -434,7 +872,7 @@ void CastleLinkLiveLib::throttleDisarm() {
 }
 
 boolean CastleLinkLiveLib::isThrottleArmed() {
-	return (TIMER_IS_RUNNING() > 0);
+	return (IS_ARMED() > 0);
 }
 
 void CastleLinkLiveLib::attachThrottlePresenceHandler(void (*ptHandler) (uint8_t) ) {
@@ -457,19 +895,29 @@ void CastleLinkLiveLib::setThrottle(uint8_t throttle) {
   else
     _throttle = throttle;
   
-  uint16_t tpht = _throttleMinTicks + ( _throttleIntervalTicks / 100.0f * ((float) _throttle) );
-  uint16_t tplt = TG_PERIOD_TICKS - tpht;
+  uint16_t tpht = _throttleMinTicks + (uint16_t) ( (_throttleStepQ16 * _throttle) >> 16 );
+  uint16_t tplt = _throttlePeriodTicks - tpht;
   
   cli(); 
   throttlePulseHighTicks = tpht;
   throttlePulseLowTicks = tplt;
   sei();
   
+#if (CLL_FREE_RUNNING_TIMER != 0)
+  cli();
+  if (armed && (! generating) ) { //not generating yet, or generation timed out
+    genDue = TIMER_CNT + _throttlePeriodTicks;
+    generating = true;
+    schedKick();
+  }
+  sei();
+#else
   if (! (TIMER_IS_COMPB_ENABLED()) ) {
     TIMER_CLEAR();
-    TIMER_SET_COMPB(TG_PERIOD_TICKS);
+    TIMER_SET_COMPB(_throttlePeriodTicks);
     TIMER_ENABLE_COMPB();
   }
+#endif
   
   if (! IS_THROTTLE_PRESENT() ) {
     SET_THROTTLE_PRESENT();
@@ -484,16 +932,12 @@ void CastleLinkLiveLib::setThrottle(uint8_t throttle) {
 }
 
 //! [ESC data calculation details]
-uint8_t CastleLinkLiveLib::getData( uint8_t index, CASTLE_ESC_DATA *o) {
+uint8_t CastleLinkLiveLib::_calcData(uint8_t index, CASTLE_RAW_DATA &c, CASTLE_ESC_DATA *o) {
   uint8_t whichTemp;
   float value;
 
-  CASTLE_RAW_DATA c;
-  
-  c.ticks[FRAME_REFERENCE] = 0;
-  
-  if (! _copyDataStructure(index, &c)) return false; //data was not ready
-  
+  if (calibratedMask & _BV(index)) return _calcDataCalibrated(index, c, o);
+
   whichTemp = CLL_GET_WHICH_TEMP(c);
 
   if (c.ticks[FRAME_REFERENCE] == 0) return false; //data was not ready
@@ -546,70 +990,593 @@ uint8_t CastleLinkLiveLib::getData( uint8_t index, CASTLE_ESC_DATA *o) {
 }
 //! [ESC data calculation details]
 
+/*
+ * fixed point calculations: base value (T - O) / R is kept in Q14
+ * format and clamped below 8, so that every product fits 32 bits
+ */
+#define FX_BASE_SHIFT 14
+#define FX_BASE_MAX 8
+#define FX_RECIP_SHIFT (FX_BASE_SHIFT + FX_BASE_SHIFT)
+
+#define FX_TEMP2_MAX ( (uint32_t) (3.9f * (1UL << FX_BASE_SHIFT)) )
+#define FX_TEMP2_STEP_SHIFT (FX_BASE_SHIFT - 4) // table step is 1/16 of base value
+
+/*
+ * CLL_CALC_TEMP2 in tenths of degree, for base values from 0 to 63/16
+ * (first entry is calculated at 1/32 since formula diverges at 0)
+ */
+static const int16_t temp2Table[] PROGMEM = {
+   2373,  1894,  1493,  1286,  1149,  1047,   967,   900,
+    843,   794,   750,   710,   674,   641,   611,   582,
+    555,   530,   506,   483,   461,   440,   420,   400,
+    381,   363,   345,   327,   310,   293,   277,   261,
+    244,   228,   213,   197,   181,   166,   150,   135,
+    119,   103,    87,    71,    55,    39,    22,     5,
+    -13,   -31,   -50,   -69,   -90,  -111,  -134,  -158,
+   -183,  -212,  -243,  -279,  -320,  -371,  -439,  -546
+};
+
+static inline uint32_t fxBase(uint16_t t, uint16_t r, uint16_t o, uint32_t recip) {
+  uint32_t d = ( t > o ? t - o : 0 );
+
+  if (d >= (uint32_t) r * FX_BASE_MAX) d = (uint32_t) r * FX_BASE_MAX - 1;
+
+  return (d * recip) >> FX_BASE_SHIFT;
+}
+
+/*
+ * nominal scales, in CASTLE_ESC_DATA_FX units per base value, of the
+ * data frames from FRAME_VOLTAGE to FRAME_TEMP1 (FRAME_TEMP2 is tabled)
+ */
+static const uint16_t fxNominal[CLL_CAL_CNT - 1] PROGMEM = {
+  20000, 4000, 5000, 1000, 2502, 20417, 4000, 4000, 300
+};
+
+static void calFold(CLL_CAL_DATA *d, uint8_t i, uint16_t gain, int16_t offset) {
+  uint32_t k = gain;
+  uint8_t s = CLL_CAL_GAIN_SHIFT;
+
+  if (i != CLL_CAL_INDEX(FRAME_TEMP2)) {
+    k *= pgm_read_word(&fxNominal[i]);
+    s += FX_BASE_SHIFT;
+  }
+
+  while (k > 0x7FFF) {
+    k >>= 1;
+    s--;
+  }
+
+  while ( (k != 0) && (k < 0x4000) && (s < 31) ) {
+    k <<= 1;
+    s++;
+  }
+
+  d->mul[i] = k;
+  d->shift[i] = s;
+  d->offset[i] = offset;
+}
+
+static inline int32_t fxCal(int32_t v, const CLL_CAL_DATA *d, uint8_t f) {
+  uint8_t i = CLL_CAL_INDEX(f);
+  return ( (v * d->mul[i]) >> d->shift[i] ) + d->offset[i];
+}
+
+static inline uint32_t fxCalBase(uint32_t base, const CLL_CAL_DATA *d, uint8_t f) {
+  uint8_t i = CLL_CAL_INDEX(f);
+  int32_t v = (int32_t) ( (base * d->mul[i]) >> d->shift[i] ) + d->offset[i];
+  return ( v < 0 ? 0 : v );
+}
+
+static inline uint16_t fxCalBase16(uint32_t base, const CLL_CAL_DATA *d, uint8_t f) {
+  uint32_t v = fxCalBase(base, d, f);
+  return ( v > 0xFFFFu ? 0xFFFFu : v );
+}
+
+static int16_t fxTemp2(uint32_t base) {
+  if (base > FX_TEMP2_MAX) return -400;
+
+  uint8_t i = base >> FX_TEMP2_STEP_SHIFT;
+  int16_t frac = base & ((1 << FX_TEMP2_STEP_SHIFT) - 1);
+  int16_t t0 = pgm_read_word(&temp2Table[i]);
+  int16_t t1 = pgm_read_word(&temp2Table[i + 1]);
+
+  return t0 + (int16_t) ( ((int32_t) (t1 - t0) * frac) >> FX_TEMP2_STEP_SHIFT );
+}
+
+uint8_t CastleLinkLiveLib::_calcDataFixed(uint8_t index, CASTLE_RAW_DATA &c, CASTLE_ESC_DATA_FX *o) {
+  const CLL_CAL_DATA *d = &(calData[index]);
+  uint16_t ref = c.ticks[FRAME_REFERENCE];
+  uint16_t off;
+  uint32_t recip;
+  int32_t t;
+
+  if (ref == 0) return false; //data was not ready
+
+  off = CLL_GET_OFFSET_TICKS(c);
+  recip = (1UL << FX_RECIP_SHIFT) / ref; //the only division
+
+  o->voltage       = fxCalBase16(fxBase(c.ticks[FRAME_VOLTAGE], ref, off, recip), d, FRAME_VOLTAGE);
+  o->rippleVoltage = fxCalBase16(fxBase(c.ticks[FRAME_RIPPLE_VOLTAGE], ref, off, recip), d, FRAME_RIPPLE_VOLTAGE);
+  o->current       = fxCalBase16(fxBase(c.ticks[FRAME_CURRENT], ref, off, recip), d, FRAME_CURRENT);
+  o->throttle      = fxCalBase16(fxBase(c.ticks[FRAME_THROTTLE], ref, off, recip), d, FRAME_THROTTLE);
+  o->outputPower   = fxCalBase16(fxBase(c.ticks[FRAME_OUTPUT_POWER], ref, off, recip), d, FRAME_OUTPUT_POWER);
+  o->RPM           = fxCalBase(fxBase(c.ticks[FRAME_RPM], ref, off, recip), d, FRAME_RPM);
+  o->BECvoltage    = fxCalBase16(fxBase(c.ticks[FRAME_BEC_VOLTAGE], ref, off, recip), d, FRAME_BEC_VOLTAGE);
+  o->BECcurrent    = fxCalBase16(fxBase(c.ticks[FRAME_BEC_CURRENT], ref, off, recip), d, FRAME_BEC_CURRENT);
+
+  if (CLL_GET_WHICH_TEMP(c) == FRAME_TEMP1)
+    t = fxCalBase(fxBase(c.ticks[FRAME_TEMP1], ref, off, recip), d, FRAME_TEMP1);
+  else
+    t = fxCal(fxTemp2(fxBase(c.ticks[FRAME_TEMP2], ref, off, recip)), d, FRAME_TEMP2);
+
+  o->temperature = ( t > 32767 ? 32767 : (t < -32768 ? -32768 : t) );
+
+  return true;
+}
+
+/*
+ * parsed data of a calibrated ESC: fixed point values, in float units
+ */
+uint8_t CastleLinkLiveLib::_calcDataCalibrated(uint8_t index, CASTLE_RAW_DATA &c, CASTLE_ESC_DATA *o) {
+  CASTLE_ESC_DATA_FX fx;
+
+  if (! _calcDataFixed(index, c, &fx)) return false;
+
+  o->voltage       = fx.voltage * 0.001f;
+  o->rippleVoltage = fx.rippleVoltage * 0.001f;
+  o->current       = fx.current * 0.01f;
+  o->throttle      = fx.throttle * 0.001f;
+  o->outputPower   = fx.outputPower * 0.0001f;
+  o->RPM           = fx.RPM;
+  o->BECvoltage    = fx.BECvoltage * 0.001f;
+  o->BECcurrent    = fx.BECcurrent * 0.001f;
+  o->temperature   = fx.temperature * 0.1f;
+
+  return true;
+}
+
+uint8_t CastleLinkLiveLib::setCalibration(uint8_t index, const CASTLE_CALIBRATION *cal) {
+  if (index >= MAX_ESCS) return false;
+
+  for (uint8_t i = 0; i < CLL_CAL_CNT; i++) {
+    if (cal)
+      calFold(&(calData[index]), i, cal->gain[i], cal->offset[i]);
+    else
+      calFold(&(calData[index]), i, CLL_CAL_GAIN_ONE, 0);
+  }
+
+  if (cal)
+    calibratedMask |= _BV(index);
+  else
+    calibratedMask &= ~ _BV(index);
+
+  return true;
+}
+
+uint8_t CastleLinkLiveLib::setCalibration(uint8_t index, uint8_t frame, uint16_t gain, int16_t offset) {
+  if ( (index >= MAX_ESCS) || (frame < FRAME_VOLTAGE) || (frame > FRAME_TEMP2) ) return false;
+
+  calFold(&(calData[index]), CLL_CAL_INDEX(frame), gain, offset);
+  calibratedMask |= _BV(index);
+
+  return true;
+}
+
+uint8_t CastleLinkLiveLib::getData( uint8_t index, CASTLE_ESC_DATA *o) {
+  CASTLE_RAW_DATA c;
+
+  if (index >= gInstalledEsc) return false;
+
+  uint8_t ret = _copyDataStructure(index, &c, NULL);
+  if (! ret) return false; //data was not ready
+
+  if (! _calcData(index, c, o)) return false;
+
+  return ret;
+}
+
+uint8_t CastleLinkLiveLib::getDataFixed( uint8_t index, CASTLE_ESC_DATA_FX *o) {
+  CASTLE_RAW_DATA c;
+
+  if (index >= gInstalledEsc) return false;
+
+  uint8_t ret = _copyDataStructure(index, &c, NULL);
+  if (! ret) return false; //data was not ready
+
+  if (! _calcDataFixed(index, c, o)) return false;
+
+  return ret;
+}
+
 uint8_t CastleLinkLiveLib::getData( uint8_t index, CASTLE_RAW_DATA *o) {
-  return _copyDataStructure(index, o);
+  if (index >= gInstalledEsc) return false;
+
+  return _copyDataStructure(index, o, NULL);
+}
+
+uint8_t CastleLinkLiveLib::getDataIfNew( uint8_t index, CASTLE_ESC_DATA *o) {
+  CASTLE_RAW_DATA c;
+
+  if (index >= gInstalledEsc) return false;
+
+  if (_copyDataStructure(index, &c, NULL) != CLL_DATA_NEW) return false;
+
+  return _calcData(index, c, o);
+}
+
+uint8_t CastleLinkLiveLib::getDataIfNew( uint8_t index, CASTLE_RAW_DATA *o) {
+  if (index >= gInstalledEsc) return false;
+
+  return (_copyDataStructure(index, o, NULL) == CLL_DATA_NEW);
+}
+
+uint8_t CastleLinkLiveLib::getDataIfNew( uint8_t index, CASTLE_RAW_DATA *o, uint8_t *seq) {
+  if (index >= gInstalledEsc) return false;
+
+  return (_copyDataStructure(index, o, seq) == CLL_DATA_NEW);
 }
 
+#if (CLL_DEFERRED_HANDLERS != 0)
+uint8_t CastleLinkLiveLib::poll() {
+  CASTLE_RAW_DATA c;
+  uint8_t pending;
+  uint8_t cnt = 0;
+
+  cli();
+  pending = handlersPendingMask;
+  handlersPendingMask = 0;
+  sei();
+
+  if (! dataAvailableHandler) return 0;
+
+  // snapshot doesn't touch read sequence: getDataIfNew still
+  // returns the sample as new afterwards
+  for (uint8_t i = 0; pending; i++, pending >>= 1) {
+    if ( (pending & 0x01) && _snapshotDataStructure(i, &c) ) {
+      dataAvailableHandler(i, &c);
+      cnt++;
+    }
+  }
+
+  return cnt;
+}
+
+uint8_t CastleLinkLiveLib::handlersPending() {
+  return handlersPendingMask;
+}
+#endif
+
+/*
+ * ESCs with a published sample neither returned to main context nor
+ * already reported by sleepUntilEvent: handler-only programs never move
+ * readSeq. To be called with interrupts disabled, as seq is moved by
+ * COMPA ISR
+ */
+static uint8_t unreadMask() {
+  uint8_t mask = 0;
+
+  for (uint8_t i = 0; i < gInstalledEsc; i++) {
+    uint8_t seq = data[i].seq;
+    if ( seq && (seq != data[i].readSeq) && (seq != data[i].wakeSeq) ) mask |= _BV(i);
+  }
+
+  return mask;
+}
+
+uint8_t CastleLinkLiveLib::sleepUntilEvent(uint8_t (*wakeCheck)(void)) {
+  uint8_t presence = IS_THROTTLE_PRESENT();
+  uint8_t unread;
+  uint8_t ev;
+#if (CLL_SLEEP_ADC_OFF != 0)
+  uint8_t adcsra = ADCSRA;
+  uint8_t acsr = ACSR;
+  uint8_t prr = ADC_PRR;
+
+  ADCSRA = adcsra & ~ _BV(ADEN); //ADC has to be disabled before its clock is stopped
+  power_adc_disable();
+  ACSR = acsr & ~ _BV(ACIE); //switching comparator off can trigger its interrupt
+  ACSR = (acsr & ~ _BV(ACIE)) | _BV(ACD);
+#endif
+
+  set_sleep_mode(SLEEP_MODE_IDLE);
+
+  for (;;) {
+    cli();
+    ev = 0;
+    unread = unreadMask();
+    if (unread) ev |= CLL_EVENT_DATA;
+#if (CLL_DEFERRED_HANDLERS != 0)
+    if (handlersPendingMask) ev |= CLL_EVENT_HANDLER;
+#endif
+    if (IS_THROTTLE_PRESENT() != presence) ev |= CLL_EVENT_THROTTLE;
+    if (wakeCheck && wakeCheck()) ev |= CLL_EVENT_WAKE;
+    if (ev) break;
+
+    sleep_enable();
+    sei(); //sei executes next instruction before any ISR: no wake-up can be lost
+    sleep_cpu();
+    sleep_disable();
+    // woken by an ISR, maybe not ours: check again
+  }
+
+  for (uint8_t i = 0; i < gInstalledEsc; i++) {
+    if (unread & _BV(i)) data[i].wakeSeq = data[i].seq; //next call waits for a newer one
+  }
+  sei();
+
+#if (CLL_SLEEP_ADC_OFF != 0)
+  ACSR = acsr & ~ _BV(ACIE); //switching comparator on can trigger its interrupt too
+  ACSR |= _BV(ACI); //ACI is cleared writing 1 to it
+  ACSR = acsr;
+  if (! (prr & _BV(PRADC)) ) power_adc_enable(); //leave ADC off if the program had stopped it
+  ADCSRA = adcsra;
+#endif
+
+  return ev;
+}
+
+uint8_t CastleLinkLiveLib::sleepUntilEvent() {
+  return sleepUntilEvent(NULL);
+}
+
+uint8_t CastleLinkLiveLib::getDataAll(CASTLE_RAW_DATA *o, uint8_t mask) {
+  uint8_t seqs[MAX_ESCS];
+  uint8_t cnt;
+  uint8_t ret = 0;
+
+  mask &= installedEscMask;
+
+  // lock-free read as in _copyDataStructure, but restarted if any ESC
+  // publishes while we copy: samples are the ones published as of the same
+  // COMPA window. Interrupts stay enabled, not to delay ESC ticks
+  do {
+    cnt = publishCnt;
+    COMPILER_BARRIER();
+    for (uint8_t i = 0; i < gInstalledEsc; i++) {
+      if (! (mask & _BV(i)) ) continue;
+      CASTLE_PRIV_DATA *d = &(data[i]);
+      seqs[i] = d->seq;
+      memcpy(&(o[i]), d->ticks[d->fill ^ 1], sizeof(uint16_t) * DATA_FRAME_CNT);
+    }
+    COMPILER_BARRIER();
+  } while (cnt != publishCnt);
+
+  for (uint8_t i = 0; i < gInstalledEsc; i++) {
+    if ( (mask & _BV(i)) && seqs[i] ) { //0: nothing published yet
+      data[i].readSeq = seqs[i];
+      ret |= _BV(i);
+    }
+  }
+
+  return ret;
+}
+
+uint8_t CastleLinkLiveLib::getDataAll(CASTLE_ESC_DATA *o, uint8_t mask) {
+  CASTLE_RAW_DATA c[MAX_ESCS];
+  uint8_t ret = getDataAll(c, mask);
+
+  for (uint8_t i = 0; i < gInstalledEsc; i++) {
+    if ( (ret & _BV(i)) && (! _calcData(i, c[i], &(o[i]))) ) ret &= ~ _BV(i);
+  }
+
+  return ret;
+}
+
+#if (CLL_FREE_RUNNING_TIMER != 0)
+uint8_t CastleLinkLiveLib::setTimer(uint8_t slot, uint16_t delay, void (*callback)(uint8_t slot)) {
+  if ( (slot >= CLL_TIMER_SLOTS) || (delay > CLL_TIMER_MAX_DELAY_US) || (callback == NULL) ) return false;
+
+  uint16_t ticks = delay * TICKS_PER_US;
+  uint8_t sreg = SREG; //may be called from a callback, with interrupts disabled
+  cli();
+
+  if (slot == slotRunning) {
+    slotDue[slot] += ticks; //from when the running callback was due: no drift
+  } else {
+    if (ticks < TIMER_MIN_AHEAD) ticks = TIMER_MIN_AHEAD;
+    slotDue[slot] = TIMER_CNT + ticks;
+  }
+
+  slotCallback[slot] = callback;
+  slotMask |= _BV(slot);
+
+  if (slotRunning == SLOT_NONE) schedKick(); //otherwise COMPB ISR reprograms after callbacks
+
+  SREG = sreg;
+  TIMER_START(); //i.e. not armed yet
+  return true;
+}
+
+void CastleLinkLiveLib::cancelTimer(uint8_t slot) {
+  if (slot >= CLL_TIMER_SLOTS) return;
+
+  uint8_t sreg = SREG;
+  cli();
+  slotMask &= ~ _BV(slot);
+  if (slotRunning == SLOT_NONE) schedKick();
+  SREG = sreg;
+}
+#endif
+
 uint16_t CastleLinkLiveLib::getShaftRPM(uint16_t eRPM, uint8_t motorPoles) {
   return (eRPM * 2 / ((float) motorPoles));
 }
 
+#if (CLL_PROFILE != 0)
+uint32_t CastleLinkLiveLib::getTimestamp() {
+  uint32_t t;
+  uint16_t cnt;
+
+  cli();
+  cnt = TIMER_CNT;
+  t = profEpoch + cnt;
+  // overflow happened before reading the counter, but OVF ISR didn't run yet
+  if ( TIMER_IS_OVF_ENABLED() && TIMER_IS_OVF_PENDING() && (cnt < 0x8000) ) t += TIMER_RESOLUTION + 1UL;
+  sei();
+
+  return t;
+}
+
+uint8_t CastleLinkLiveLib::getProfile(uint8_t isr, CLL_PROFILE_DATA *o, uint8_t reset) {
+  if (isr >= CLL_PROF_CNT) return false;
+
+  cli();
+  memcpy(o, &(prof[isr]), sizeof(CLL_PROFILE_DATA));
+  if (reset) memset(&(prof[isr]), 0, sizeof(CLL_PROFILE_DATA));
+  sei();
+
+  return true;
+}
+#endif
+
 
 /*
  * Interrupt Service Routines and related functions
  ****************************************************/
 
 //=== INT0/INT1/INT... (external interrupts) handlers: get data from ESC(s)
-inline void escInterruptHandler(uint8_t index) {
-  uint16_t ticks = TIMER_CNT;
-
+inline void escTickHandler(uint8_t index, uint16_t ticks) {
   if (ticks == 0) return; //timer was stopped
   
   CASTLE_PRIV_DATA *d = &(data[index]);
   
+  if (d->frameIdx >= DATA_FRAME_CNT - 1) { //spurious tick: frame set already full, or not synced yet
+    if (d->frameIdx == FRAME_UNSYNCED) d->ticked = true; //not a reset frame
+    return;
+  }
+
   d->frameIdx++;
   
-  d->ticks[d->frameIdx] = ticks;
+  d->ticks[d->fill][d->frameIdx] = ticks;
   d->ticked = true;
   
   d->ready = (d->frameIdx == DATA_FRAME_CNT -1);
 }
 
-#ifdef ESC0_ISR
+inline void escInterruptHandler(uint8_t index) {
+  escTickHandler(index, EDGE_ELAPSED(TIMER_CNT));
+}
+
+#if (CLL_BENCHMARK != 0)
+// synthetic tick train: reference (1 ms), data frames with slowly changing
+// values, TEMP1 as the 0.5 ms offset, then a reset frame without tick
+inline void benchTickHandler() {
+  for (uint8_t i = 0; i < gInstalledEsc; i++) {
+    uint8_t f = benchSlot[i];
+
+    if (f == DATA_FRAME_CNT) {
+      benchSlot[i] = 0;
+      if (i == 0) benchSample++;
+      continue;
+    }
+
+    if (f == FRAME_REFERENCE)
+      escTickHandler(i, 2 * TICKS_PER_US * 500);
+    else if (f == FRAME_TEMP1)
+      escTickHandler(i, TICKS_PER_US * 500);
+    else
+      escTickHandler(i, TICKS_PER_US * 500 + (f << 8) + ( (uint8_t) (benchSample + i) & 0x3F ));
+
+    benchSlot[i] = f + 1;
+  }
+}
+#define BENCH_TICKS() benchTickHandler()
+#else
+#define BENCH_TICKS()
+#endif
+
+#if (CLL_ESC0_CAPTURE != 0)
+// tick edge timestamp was latched by input capture unit
+ISR(ESC_CAPTURE_ISR) {
+  PROF_ENTER();
+  PROF_LATENCY(CLL_PROF_ESC, TIMER_CNT - ESC_CAPTURE_REG);
+  escTickHandler(0, EDGE_ELAPSED(ESC_CAPTURE_REG));
+  PROF_EXIT(CLL_PROF_ESC);
+}
+#elif defined(ESC0_ISR)
 ISR(ESC0_ISR) {
+  PROF_ENTER();
   escInterruptHandler(0);
+  PROF_EXIT(CLL_PROF_ESC);
 }
 #endif
 
 #ifdef ESC1_ISR
 ISR(ESC1_ISR) {
+  PROF_ENTER();
   escInterruptHandler(1);
+  PROF_EXIT(CLL_PROF_ESC);
 }
 #endif
 
 #ifdef ESC2_ISR
 ISR(ESC2_ISR) {
+  PROF_ENTER();
   escInterruptHandler(2);
+  PROF_EXIT(CLL_PROF_ESC);
 }
 #endif
 
 #ifdef ESC3_ISR
 ISR(ESC3_ISR) {
+  PROF_ENTER();
   escInterruptHandler(3);
+  PROF_EXIT(CLL_PROF_ESC);
 }
 #endif
 
 #ifdef ESC4_ISR
 ISR(ESC4_ISR) {
+  PROF_ENTER();
   escInterruptHandler(4);
+  PROF_EXIT(CLL_PROF_ESC);
+}
+#endif
+
+#ifdef ESCX_ISR
+// PCINT ESC channels: one timer read for all ESCs ticking together,
+// rising edges (end of ticks) only update pin status
+ISR(ESCX_ISR) {
+  PROF_ENTER();
+  uint16_t t = EDGE_ELAPSED(TIMER_CNT);
+  uint8_t pins = ESCX_READ_PORT;
+  uint8_t fell = escxLastPins & ~ pins & ESCX_PINS_HIGH_MASK;
+  escxLastPins = pins;
+
+  for (uint8_t i = ESCX_FIRST; fell; i++, fell >>= 1) {
+    if (fell & 0x01) escTickHandler(i, t);
+  }
+  PROF_EXIT(CLL_PROF_ESC);
 }
 #endif
 
+//=== throttle pulse end: open telemetry window, unless current frame is skipped
+inline void __attribute__((always_inline)) escWindowOpen() {
+  if (skipCnt) {
+    skipCnt--;
+    return;
+  }
+
+  listening = true;
+  ESC_DDR &= ESC_PINS_LOW_MASK; //set esc pins as inputs
+  ESCX_SET_INPUT();
+#ifndef DISABLE_ALL_PULLUPS  
+  ESC_WRITE_PORT &= ESC_PINS_LOW_MASK; //write LOW to esc pins to disable pullups if not globally disabled
+  ESCX_WRITE_LOW();
+#endif
+  EIFR |= EXT_INT_CLEAR_MASK; // clear INTn flags before enabling interrupts
+  EIMSK |= EXT_INT_ENABLE_MASK; //enable interrupts on INTn
+  CAPTURE_START();
+  ESCX_START();
+  BENCH_TICKS();
+}
+
 //=== PinChange interrupt handlers: get throttle signal
 inline void throttleInterruptHandler(uint8_t pinStatus) {
   if ( pinStatus ) {  // throttle pulse start
-     ESC_WRITE_PORT &= escPinsLowMask; //write LOW to ESCs pins
-     TIMER_CLEAR();
+     ESC_WRITE_PORT &= ESC_PINS_LOW_MASK; //write LOW to ESCs pins
+     ESCX_WRITE_LOW();
+     THROTTLE_EDGE(TIMER_CNT);
 #if (LED_DISABLE == 0)
      ledCnt++;
      ledCnt = ledCnt % ledMod;
@@ -619,30 +1586,27 @@ inline void throttleInterruptHandler(uint8_t pinStatus) {
        LED_OFF();
 #endif
   } else {                            // throttle pulse end
-     ESC_WRITE_PORT |= escPinsHighMask; //write high to ESCs pins
+     ESC_WRITE_PORT |= ESC_PINS_HIGH_MASK; //write high to ESCs pins
+     ESCX_WRITE_HIGH();
+     uint16_t now = TIMER_CNT;
 #if (LED_DISABLE == 0)
-     uint16_t t = TCNT1;
+     uint16_t t = EDGE_ELAPSED(now); //pulse duration
 #endif
-     TIMER_CLEAR();
+     THROTTLE_EDGE(now);
 
 #if (LED_DISABLE == 0)
-     if (t < _throttleMinTicks)
+     if (t < THROTTLE_MIN_TICKS)
        t = 0;
      else
-       t -= _throttleMinTicks;
+       t -= THROTTLE_MIN_TICKS;
      
-     if (t >= _throttleIntervalTicks)
+     if (t >= THROTTLE_INTERVAL_TICKS)
        ledMod = 1;
      else
-       ledMod = 100 - ( t / ((float) (_throttleIntervalTicks)) * 100.0f) + 1;
+       ledMod = 100 - ( (t * LED_SCALE_Q16) >> 16 ) + 1;
 #endif
 
-     ESC_DDR &= escPinsLowMask; //set esc pins as inputs
-#ifndef DISABLE_ALL_PULLUPS  
-     ESC_WRITE_PORT &= escPinsLowMask; //write LOW to esc pins to disable pullups if not globally disabled
-#endif
-     EIFR |= extIntClearMask; // clear INTn flags before enabling interrupts
-     EIMSK |= extIntEnableMask; //enable interrupts on INTn
+     escWindowOpen();
   }
   
   throttleFailCnt = 0; //reset throttle failure counter  
@@ -663,52 +1627,106 @@ inline void throttleNotPresent() {
   }  
 }
 
+#if (CLL_STATIC_THROTTLE != CLL_THROTTLE_GENERATE)
 #ifdef PCIE0
 // PORTB
 ISR(PCINT0_vect) {
+  PROF_ENTER();
   throttleInterruptHandler( PINB & throttlePinMask );
+  PROF_EXIT(CLL_PROF_THROTTLE);
 }
 #endif
 
-#ifdef PCIE1
+#if defined(PCIE1) && ! defined(ESCX_ISR)
 //PORTC
 ISR(PCINT1_vect) {
+  PROF_ENTER();
   throttleInterruptHandler( PINC & throttlePinMask );
+  PROF_EXIT(CLL_PROF_THROTTLE);
 }
 #endif
 
 #ifdef PCIE2
 //PORTD
 ISR(PCINT2_vect) {
+  PROF_ENTER();
   throttleInterruptHandler( PIND & throttlePinMask );
+  PROF_EXIT(CLL_PROF_THROTTLE);
 }
 #endif
+#endif //CLL_STATIC_THROTTLE != CLL_THROTTLE_GENERATE
 
 //=== TIMER interrupts handlers
 
+// castle data timeout: per-ESC part
+// (always inlined so that, with a constant index, data[i] address is constant)
+inline void __attribute__((always_inline)) escTimeoutHandler(uint8_t i) {
+  CASTLE_PRIV_DATA *d = &(data[i]);
+
+  //if castle ESC ticked some data in, reset the ticked indicator for next cycle
+  //otherwise, it was a reset frame
+  if (d->ticked)
+    d->ticked = false;
+  else
+    d->frameIdx = FRAME_RESET;
+
+  if (d->frameIdx == FRAME_RESET && d->ready) {
+    //data for this ESC is complete: publish it swapping buffers
+    d->fill ^= 1;
+    if (++(d->seq) == 0) d->seq = 1;
+    d->ready = false;
+    burstMask |= _BV(i);
+    publishCnt++;
+#if (CLL_DEFERRED_HANDLERS != 0)
+    handlersPendingMask |= _BV(i);
+#else
+    if (dataAvailableHandler) dataAvailableHandler(i, (CASTLE_RAW_DATA *) d->ticks[d->fill ^ 1]);
+#endif
+  }
+}
+
 // castle data timeout
 ISR(TIMER_COMPA_ISR) {
-  EIMSK &= extIntDisableMask; //disable INTn interrupt
-  // timeout elapsed, so restore output mode for ESC pins in any case
+  PROF_ENTER();
+  PROF_LATENCY(CLL_PROF_COMPA, TIMER_CNT - TIMER_GET_COMPA());
+
+  if (listening) { //skipped frames: ESC pins are already outputs
+    listening = false;
+    EIMSK &= EXT_INT_DISABLE_MASK; //disable INTn interrupt
+    CAPTURE_STOP();
+    ESCX_STOP();
+    // timeout elapsed, so restore output mode for ESC pins in any case
 #ifndef DISABLE_ALL_PULLUPS  
-  ESC_WRITE_PORT |= escPinsHighMask; //write high to esc pins before switching to output if pullups are not globally disabled
+    ESC_WRITE_PORT |= ESC_PINS_HIGH_MASK; //write high to esc pins before switching to output if pullups are not globally disabled
+    ESCX_WRITE_HIGH();
+#endif
+    ESC_DDR |= ESC_PINS_HIGH_MASK;  //set esc pins to output
+    ESCX_SET_OUTPUT();
+
+#if (CLL_STATIC_NESC > 0)
+    escTimeoutHandler(0);
+    if (CLL_STATIC_NESC > 1) escTimeoutHandler(1);
+    if (CLL_STATIC_NESC > 2) escTimeoutHandler(2);
+    if (CLL_STATIC_NESC > 3) escTimeoutHandler(3);
+    if (CLL_STATIC_NESC > 4) escTimeoutHandler(4);
+    if (CLL_STATIC_NESC > 5) escTimeoutHandler(5);
+    if (CLL_STATIC_NESC > 6) escTimeoutHandler(6);
+    if (CLL_STATIC_NESC > 7) escTimeoutHandler(7);
+#else
+    for (int i = 0; i < gInstalledEsc; i++) escTimeoutHandler(i);
 #endif
-  ESC_DDR |= escPinsHighMask;  //set esc pins to output
-
-  for (int i = 0; i < gInstalledEsc; i++) {
-	CASTLE_PRIV_DATA *d = &(data[i]);
-
-    //if castle ESC ticked some data in, reset the ticked indicator for next cycle
-    //otherwise, it was a reset frame
-    if (d->ticked)
-      d->ticked = false;
-    else
-      d->frameIdx = FRAME_RESET;
 
-    if (d->frameIdx == FRAME_RESET && d->ready) {
-      flags &= ~ _BV(i); //data for this ESC is ready: clear busy flag
-      d->ready = false;
-      if (dataAvailableHandler) dataAvailableHandler(i, (CASTLE_RAW_DATA *) d);
+    // decimated telemetry: burst ends when every ESC gave a sample,
+    // or after two cycles if any ESC doesn't
+    if ( listenSkipFrames && ( (burstMask == installedEscMask) || (++burstFrames >= 2 * FRAME_CYCLE) ) ) {
+      skipCnt = listenSkipFrames;
+      burstFrames = 0;
+      burstMask = 0;
+      // ESCs keep sending frames while we don't listen
+      for (int i = 0; i < gInstalledEsc; i++) {
+        data[i].frameIdx = FRAME_UNSYNCED;
+        data[i].ticked = false;
+      }
     }
   }
 
@@ -722,16 +1740,17 @@ ISR(TIMER_COMPA_ISR) {
       LED_OFF();
   }
 #endif
-  
-}
 
-// generated throttle interrupts
-ISR(TIMER_COMPB_ISR) {
-  TIMER_CLEAR(); //clear timer
+  PROF_EXIT(CLL_PROF_COMPA);
+}
 
-  if ( (ESC_WRITE_PORT & escPinsHighMask) ) { //throttle out is HIGH: pulse start
-	ESC_WRITE_PORT &= escPinsLowMask; //set throttle out LOW
-    TIMER_SET_COMPB(throttlePulseHighTicks); //set COMPB to trigger again after pulse-long ticks
+#if (CLL_STATIC_THROTTLE != CLL_THROTTLE_EXTERNAL)
+// generated throttle: an edge is due
+inline void __attribute__((always_inline)) throttleGenEdge() {
+  if ( (ESC_WRITE_PORT & ESC_PINS_HIGH_MASK) ) { //throttle out is HIGH: pulse start
+	ESC_WRITE_PORT &= ESC_PINS_LOW_MASK; //set throttle out LOW
+	ESCX_WRITE_LOW();
+    GEN_NEXT(throttlePulseHighTicks); //next edge after pulse-long ticks
 
 #if (LED_DISABLE == 0)
     ledCnt++;
@@ -744,36 +1763,90 @@ ISR(TIMER_COMPB_ISR) {
 
   } else { //throttle out is LOW: pulse end
 
-	ESC_WRITE_PORT |= escPinsHighMask; //set throttle out HIGH
-    TIMER_SET_COMPB(throttlePulseLowTicks); //set COMPB to trigger again after remaining period time elapses
+	ESC_WRITE_PORT |= ESC_PINS_HIGH_MASK; //set throttle out HIGH
+	ESCX_WRITE_HIGH();
+    GEN_NEXT(throttlePulseLowTicks); //next edge after remaining period time elapses
+    GEN_PULSE_END();
 
 	//prepare ESC pins to wait for data tick
-    ESC_DDR &= escPinsLowMask; //set esc pins as inputs
-#ifndef DISABLE_ALL_PULLUPS  
-    ESC_WRITE_PORT &= escPinsLowMask; //write LOW to esc pins to disable pullups if not globally disabled
-#endif
-    EIFR |= extIntClearMask; // clear INTn flags before enabling
-    EIMSK |= extIntEnableMask; //enable interrupts on INTn
+    escWindowOpen();
 
     throttleFailCnt++; //increase throttle failure counter: 
   }
 
   //check for throttle failure
-  if (throttleFailCnt >= MAX_NO_THROTTLE_GEN) {
-    TIMER_DISABLE_COMPB(); //disable interrupt generation (stops generating throttle signal)
-    ESC_WRITE_PORT |= escPinsHighMask; //esc pins high!
-    ESC_DDR |= escPinsHighMask; //esc pins as output!
+  if (throttleFailCnt >= _maxNoThrottleGen) {
+    GEN_STOP(); //stop generating throttle signal
+    ESC_WRITE_PORT |= ESC_PINS_HIGH_MASK; //esc pins high!
+    ESCX_WRITE_HIGH();
+    ESC_DDR |= ESC_PINS_HIGH_MASK; //esc pins as output!
+    ESCX_SET_OUTPUT();
     throttleNotPresent();
   }
 }
+#endif //CLL_STATIC_THROTTLE != CLL_THROTTLE_EXTERNAL
+
+#if (CLL_FREE_RUNNING_TIMER != 0)
+// compare unit B scheduler: runs every event due since the programmed
+// match (ref), throttle edge first, then programs the next one
+ISR(TIMER_COMPB_ISR) {
+  PROF_ENTER();
+  PROF_LATENCY(CLL_PROF_COMPB, TIMER_CNT - TIMER_GET_COMPB());
+  uint16_t ref = TIMER_GET_COMPB();
+
+  // stale match: an event ran without waiting for it, then OCR moved ahead.
+  // Every pending event is later than now: just reprogram
+  if ( (uint16_t) (TIMER_CNT - ref) > TIMER_RESOLUTION / 2 ) ref = TIMER_CNT;
+
+  for (;;) {
+    uint16_t elapsed = TIMER_CNT - ref;
+
+#if (CLL_STATIC_THROTTLE != CLL_THROTTLE_EXTERNAL)
+    if ( generating && ((uint16_t) (genDue - ref) <= elapsed) ) throttleGenEdge();
+#endif
+
+    for (uint8_t s = 0; s < CLL_TIMER_SLOTS; s++) {
+      if ( (slotMask & _BV(s)) && ((uint16_t) (slotDue[s] - ref) <= elapsed) ) {
+        slotMask &= ~ _BV(s);
+        slotRunning = s;
+        slotCallback[s](s);
+        slotRunning = SLOT_NONE;
+      }
+    }
 
-// overflow: won't fire if regular throttle signal (external) is present
+    if (schedProgram(ref)) break;
+    TIMER_CLEAR_COMPB_PENDING(); //we run it now: its match may be set already
+  }
+
+  PROF_EXIT(CLL_PROF_COMPB);
+}
+#elif (CLL_STATIC_THROTTLE != CLL_THROTTLE_EXTERNAL)
+// generated throttle interrupts
+ISR(TIMER_COMPB_ISR) {
+  PROF_ENTER();
+  PROF_LATENCY(CLL_PROF_COMPB, TIMER_CNT - TIMER_GET_COMPB());
+  ISR_TIMER_CLEAR(); //clear timer
+
+  throttleGenEdge();
+
+  PROF_EXIT(CLL_PROF_COMPB);
+}
+#endif
+
+// overflow: won't fire if regular throttle signal (external) is present,
+// unless the timer is free running: then edges reset the failure counter
 ISR(TIMER_OVF_ISR) {
+  PROF_OVERFLOW();
+#if (CLL_FREE_RUNNING_TIMER != 0)
+  if ( (! externalThrottle) || (! armed) ) return; //enabled for profiling timebase only
+#endif
   throttleFailCnt++; //increase throttle failure counter
 
   if (throttleFailCnt >= MAX_OVERFLOW) {
-    ESC_WRITE_PORT |= escPinsHighMask;
-    ESC_DDR |= escPinsHighMask;
+    ESC_WRITE_PORT |= ESC_PINS_HIGH_MASK;
+    ESCX_WRITE_HIGH();
+    ESC_DDR |= ESC_PINS_HIGH_MASK;
+    ESCX_SET_OUTPUT();
     throttleNotPresent();
     throttleFailCnt = 0; //reset throttle failure counter
   }
@@ -54,7 +54,8 @@
       (i.e. analogWrite) must not be called on these pins.
     - ExternalInterrupt capable pins (on ATmega168/328 Arduinos they are pins 2 and 3)
       will be used by the library to drive and receive data from the ESC(s), so they 
-      must not be used by the program.
+      must not be used by the program. The same goes for PORTC pins A0-A5 used
+      for ESCs from the third on, when the library is built with CLL_PCINT_ESCS.
     - One pin is used to read throttle signal generated by a standard RC receiver, 
       and must not be used by the program. However that pin can be chosen (almost) 
       arbitrary.
@@ -121,6 +122,36 @@
 */
 #define GENERATE_THROTTLE     -1
 
+/** \brief Returned by CastleLinkLiveLib::getData when the sample was already returned by a previous call
+    @see CastleLinkLiveLib::getData(uint8_t index, CASTLE_RAW_DATA *dataHolder)
+*/
+#define CLL_DATA_OLD           1
+
+/** \brief Returned by CastleLinkLiveLib::getData when the sample is fresh (never returned before)
+    @see CastleLinkLiveLib::getData(uint8_t index, CASTLE_RAW_DATA *dataHolder)
+*/
+#define CLL_DATA_NEW           2
+
+/** \brief Set in CastleLinkLiveLib::sleepUntilEvent return value when an ESC has a sample never returned by getData nor reported by a previous sleepUntilEvent call
+    @see CastleLinkLiveLib::sleepUntilEvent(uint8_t (*wakeCheck)(void))
+*/
+#define CLL_EVENT_DATA         0x01
+
+/** \brief Set in CastleLinkLiveLib::sleepUntilEvent return value when a deferred data available handler call is pending
+    @see CastleLinkLiveLib::sleepUntilEvent(uint8_t (*wakeCheck)(void))
+*/
+#define CLL_EVENT_HANDLER      0x02
+
+/** \brief Set in CastleLinkLiveLib::sleepUntilEvent return value when throttle presence changed while sleeping
+    @see CastleLinkLiveLib::sleepUntilEvent(uint8_t (*wakeCheck)(void))
+*/
+#define CLL_EVENT_THROTTLE     0x04
+
+/** \brief Set in CastleLinkLiveLib::sleepUntilEvent return value when the program wake check returned non-zero
+    @see CastleLinkLiveLib::sleepUntilEvent(uint8_t (*wakeCheck)(void))
+*/
+#define CLL_EVENT_WAKE         0x08
+
 /**@}*/
 
 /** \anchor cll_data_frames_ids */
@@ -164,6 +195,8 @@
 	For any telemetry value, you have to calc the base value using
 	CLL_BASE_VALUE(T, R, O) and use it to feed CLL_CALC_*(V) macros and
 	obtain the final value.
+	CLL_CALC_*(V) macros use nominal Castle scales: calibration profiles
+	(see CASTLE_CALIBRATION) don't apply to them.
 
 	CLL_BASE_VALUE(T, R, O) needs three parameters:
 	 - T is ticks count for the desired telemetry value. You can get it with CLL_GET_*_TICKS(D) macros.
@@ -421,6 +454,89 @@ typedef struct castle_esc_data_struct {
 
 } CASTLE_ESC_DATA;
 
+/** \brief Structure to hold ESC telemetry data as scaled integers
+
+    Same telemetry as CASTLE_ESC_DATA, but every value is an integer in a
+    fixed unit. It's filled by uint8_t CastleLinkLiveLib::getDataFixed (uint8_t index, CASTLE_ESC_DATA_FX *dataHolder)
+    using integer math only, so it's much faster than CASTLE_ESC_DATA on
+    boards without a floating point unit (i.e. all AVR Arduinos).
+    @see uint8_t CastleLinkLiveLib::getDataFixed (uint8_t index, CASTLE_ESC_DATA_FX *dataHolder)
+    @see CASTLE_ESC_DATA
+*/
+typedef struct castle_esc_data_fx_struct {
+  uint16_t voltage;       /**< \brief Battery voltage in millivolts */
+  uint16_t rippleVoltage; /**< \brief Ripple voltage in millivolts */
+  uint16_t current;       /**< \brief Current drawn by motor in hundredths of Ampere */
+  uint16_t throttle;      /**< \brief throttle pulse duration as seen by the ESC (in microseconds) */
+  uint16_t outputPower;   /**< \brief power level the ESC is driving the motor with, in ten-thousandths:
+                               value goes from 0 for idle to 10000 for full throttle. */
+  uint32_t RPM;           /**< \brief Electrical RPM (see CASTLE_ESC_DATA::RPM) */
+  uint16_t BECvoltage;    /**< \brief Voltage at the BEC (Battery Eliminator Circuit) in millivolts */
+  uint16_t BECcurrent;    /**< \brief Current drawn by servos and any other device powered by the BEC in milliamperes */
+  int16_t temperature;    /**< \brief Temperature of the ESC in tenths of degree Celsius */
+
+} CASTLE_ESC_DATA_FX;
+
+/** \name Calibration
+    Calibration profiles correct values converted with nominal Castle scales (see CLL_CALC_* macros)
+    for a specific ESC model: a profile holds a gain and an offset for every data frame
+*/
+/**@{*/
+#define CLL_CAL_CNT          ( DATA_FRAME_CNT - 1 ) /**< \brief number of calibrated data frames (all but reference) */
+#define CLL_CAL_INDEX(F)     ( (F) - 1 )            /**< \brief index of data frame F in CASTLE_CALIBRATION arrays */
+#define CLL_CAL_GAIN_SHIFT   12                     /**< \brief gains are fixed point, with 12 fractional bits */
+#define CLL_CAL_GAIN_ONE     ( 1 << CLL_CAL_GAIN_SHIFT ) /**< \brief gain of a nominal profile (1.0) */
+/**@}*/
+
+/** \brief Structure to hold the calibration profile of an ESC
+
+    Every value is corrected to value * gain / CLL_CAL_GAIN_ONE + offset, where
+    offset is in CASTLE_ESC_DATA_FX units (i.e. millivolts for voltage). Both
+    temperature frames correct CASTLE_ESC_DATA_FX::temperature.
+    A nominal profile has every gain set to CLL_CAL_GAIN_ONE and every offset to 0.
+    @see uint8_t CastleLinkLiveLib::setCalibration(uint8_t index, const CASTLE_CALIBRATION *cal)
+*/
+typedef struct castle_calibration_struct {
+  uint16_t gain[CLL_CAL_CNT];  /**< \brief gain of each data frame, indexed by CLL_CAL_INDEX(FRAME_*) */
+  int16_t offset[CLL_CAL_CNT]; /**< \brief offset of each data frame, indexed by CLL_CAL_INDEX(FRAME_*) */
+} CASTLE_CALIBRATION;
+
+/** \brief Longest delay of timer callbacks (in microseconds), when CLL_FREE_RUNNING_TIMER is set
+    @see CastleLinkLiveLib::setTimer(uint8_t slot, uint16_t delay, void (*callback)(uint8_t slot))
+*/
+#define CLL_TIMER_MAX_DELAY_US 30000u
+
+/** \name Profiled interrupt routines
+    Indexes of interrupt routines instrumented when CLL_PROFILE is set,
+    used as "isr" argument of CastleLinkLiveLib::getProfile
+*/
+/**@{*/
+#define CLL_PROF_COMPA     0 /**< \brief telemetry window timeout (timer compare A) */
+#define CLL_PROF_COMPB     1 /**< \brief throttle generation (timer compare B) */
+#define CLL_PROF_ESC       2 /**< \brief ESC ticks (external interrupts or input capture) */
+#define CLL_PROF_THROTTLE  3 /**< \brief external throttle signal (pin change) */
+#define CLL_PROF_CNT       4
+/**@}*/
+
+/** \brief Number of buckets of profile histograms */
+#define CLL_PROF_BUCKETS  12
+
+/** \brief Structure to hold profile histograms of an interrupt routine
+
+    Bucket 0 counts zero-tick samples, bucket n (n > 0) counts samples
+    from 2^(n-1) to 2^n - 1 timer ticks, last bucket counts all
+    longer samples. Counters saturate at 65535.
+    Entry latency is measured from the compare match for timer routines
+    and from the tick edge for ESC0 when CLL_ESC0_CAPTURE is set; it
+    can't be measured (and is not recorded) for other ESCs and for
+    external throttle.
+    @see uint8_t CastleLinkLiveLib::getProfile(uint8_t isr, CLL_PROFILE_DATA *dataHolder, uint8_t reset)
+*/
+typedef struct cll_profile_data_struct {
+  uint16_t latency[CLL_PROF_BUCKETS];  /**< \brief entry latency histogram */
+  uint16_t duration[CLL_PROF_BUCKETS]; /**< \brief duration histogram */
+} CLL_PROFILE_DATA;
+
 /** \brief CastleLinkLive4Arduino Library Class
 
     The library purpose is to get live telemetry data from
@@ -482,7 +598,7 @@ class CastleLinkLiveLib {
    
    /** \brief Starts the library indicating the number of ESC connected
        Throttle signal will be software generated by the library
-       @param [in] nESC the number of ESC(s) connected (up to 2)
+       @param [in] nESC the number of ESC(s) connected (up to 2, or 2 + CLL_PCINT_ESCS, on ATmega168/328 Arduinos)
 
        This is equivalent to call 
        \code begin(nESC, GENERATE_THROTTLE) \endcode
@@ -491,7 +607,7 @@ class CastleLinkLiveLib {
    
    /** \brief Starts the library indicating the number of ESC connected and the arduino pin that will
        be used to read throttle signal.
-       @param[in] nESC the number of ESC(s) connected (up to 2)
+       @param[in] nESC the number of ESC(s) connected (up to 2, or 2 + CLL_PCINT_ESCS, on ATmega168/328 Arduinos)
        @param[in] throttlePinNumber any valid Arduino pin (except the already used ones) or GENERATE_THROTTLE
        macro to let the library generate the throttle signal itself.
        @see GENERATE_THROTTLE
@@ -500,7 +616,7 @@ class CastleLinkLiveLib {
 
    /** \brief Starts the library indicating the number of ESC connected, the arduino pin that will
        be used to read throttle signal, minimum and maximum pulse duration for throttle signal
-       @param [in] nESC the number of ESC(s) connected (up to 2)
+       @param [in] nESC the number of ESC(s) connected (up to 2, or 2 + CLL_PCINT_ESCS, on ATmega168/328 Arduinos)
        @param [in] throttlePinNumber any valid Arduino pin (except the already used ones) or GENERATE_THROTTLE 
        macro to let the library generate the throttle signal itself.
        @param [in] throttleMin specifies throttle signal pulse duration corresponding to idle/brake
@@ -509,6 +625,78 @@ class CastleLinkLiveLib {
        (in microseconds: default value is 2000, and can be changed in CastleLinkLive_config.h).
    */
    uint8_t begin(uint8_t nESC, int throttlePinNumber, uint16_t throttleMin, uint16_t throttleMax);
+
+   /** \brief Starts the library as begin(uint8_t nESC, int throttlePinNumber, uint16_t throttleMin, uint16_t throttleMax)
+       also setting the period of software generated throttle signal
+       @param [in] nESC the number of ESC(s) connected (up to 2, or 2 + CLL_PCINT_ESCS, on ATmega168/328 Arduinos)
+       @param [in] throttlePinNumber any valid Arduino pin (except the already used ones) or GENERATE_THROTTLE 
+       macro to let the library generate the throttle signal itself.
+       @param [in] throttleMin specifies throttle signal pulse duration corresponding to idle/brake (in microseconds).
+       @param [in] throttleMax specifies throttle signal pulse duration corresponding to full throttle (in microseconds).
+       @param [in] framePeriod generated throttle signal period, in microseconds (default value is 20000, and can be 
+       changed in CastleLinkLive_config.h). Ignored when reading external throttle.
+       After each pulse the ESC needs a 6 ms window to send its telemetry tick, so period 
+       can't be shorter than throttleMax + 6500 us (8500 us, ~117 Hz, with default bounds), 
+       nor longer than timer overflow (32767 us @ 16MHz).
+       @return false if framePeriod is out of these bounds
+   */
+   uint8_t begin(uint8_t nESC, int throttlePinNumber, uint16_t throttleMin, uint16_t throttleMax, uint16_t framePeriod);
+
+   /** \brief Starts the library as begin(uint8_t nESC, int throttlePinNumber, uint16_t throttleMin, uint16_t throttleMax, uint16_t framePeriod)
+       also setting how often telemetry is listened to.
+
+       A telemetry cycle (a sample for every ESC) takes 12 throttle frames. With listenCycles
+       greater than 1, once every ESC completed a sample the library relays throttle only
+       for the frames of the next listenCycles - 1 cycles: ESC pins stay outputs and telemetry
+       interrupts are not enabled, so each ESC gives at most a sample every listenCycles cycles
+       (i.e. ~2 Hz with 20 ms frames and listenCycles = 2, instead of ~4.2 Hz).
+       If an ESC doesn't complete a sample within two cycles, the library stops listening anyway.
+
+       @param [in] nESC the number of ESC(s) connected (up to 2, or 2 + CLL_PCINT_ESCS, on ATmega168/328 Arduinos)
+       @param [in] throttlePinNumber any valid Arduino pin (except the already used ones) or GENERATE_THROTTLE 
+       macro to let the library generate the throttle signal itself.
+       @param [in] throttleMin specifies throttle signal pulse duration corresponding to idle/brake (in microseconds).
+       @param [in] throttleMax specifies throttle signal pulse duration corresponding to full throttle (in microseconds).
+       @param [in] framePeriod generated throttle signal period, in microseconds. Ignored when reading external throttle.
+       @param [in] listenCycles listen to a telemetry cycle every listenCycles (1 listens to every cycle)
+       @return false if framePeriod is out of bounds or listenCycles is 0
+   */
+   uint8_t begin(uint8_t nESC, int throttlePinNumber, uint16_t throttleMin, uint16_t throttleMax, uint16_t framePeriod, uint8_t listenCycles);
+
+   /** \brief Starts the library as begin(uint8_t nESC, int throttlePinNumber, uint16_t throttleMin, uint16_t throttleMax, uint16_t framePeriod, uint8_t listenCycles)
+       also setting calibration profiles of the ESCs.
+
+       @param [in] cal array of nESC calibration profiles, indexed by ESC index. If NULL,
+       profiles already set by setCalibration(...) are kept.
+       @see setCalibration(uint8_t index, const CASTLE_CALIBRATION *cal)
+   */
+   uint8_t begin(uint8_t nESC, int throttlePinNumber, uint16_t throttleMin, uint16_t throttleMax, uint16_t framePeriod, uint8_t listenCycles, const CASTLE_CALIBRATION *cal);
+
+   /** \brief Sets the calibration profile of an ESC
+
+       Gains are folded with nominal scales into one multiplier per data frame, so
+       getDataFixed(...) converts each value with a multiply and a shift, as with the
+       nominal profile. getData(...) of a calibrated ESC returns getDataFixed(...)
+       values in CASTLE_ESC_DATA units.
+       Can be called before begin(...) and at any time afterwards, but not from
+       interrupt context (i.e. from a data available handler).
+
+       @param [in] index ESC index. First ESC index is 0
+       @param [in] cal calibration profile, or NULL to go back to nominal scales
+       @return false if index is not valid
+       @see CASTLE_CALIBRATION
+   */
+   uint8_t setCalibration(uint8_t index, const CASTLE_CALIBRATION *cal);
+
+   /** \brief Sets the calibration of a single data frame of an ESC
+       @param [in] index ESC index. First ESC index is 0
+       @param [in] frame data frame (FRAME_VOLTAGE to FRAME_TEMP2)
+       @param [in] gain gain, CLL_CAL_GAIN_ONE for 1.0
+       @param [in] offset offset, in CASTLE_ESC_DATA_FX units
+       @return false if index or frame are not valid
+       @see setCalibration(uint8_t index, const CASTLE_CALIBRATION *cal)
+   */
+   uint8_t setCalibration(uint8_t index, uint8_t frame, uint16_t gain, int16_t offset);
    
    /** \brief Sets throttle value to drive the ESC(s) when in software generated throttle
        
@@ -572,35 +760,217 @@ class CastleLinkLiveLib {
        void dataAvailable(uint8_t escIndex, uint8_t frameIndex, uint16_t ticks)
        \endcode
 
-       Will be called by an ISR (interrupt service routine).
+       Will be called by an ISR (interrupt service routine), unless the library
+       is built with CLL_DEFERRED_HANDLERS set: then it's called from main
+       context by poll().
 
 	   @param[in] ptHandler is the program-defined function to attach.
+       @see poll()
    */
    void attachDataAvailableHandler( void (*ptHandler) (uint8_t escIndex, CASTLE_RAW_DATA *data) ) ;
 
    /** \brief Gets human-readable parsed data for the index-ESC from the library. This data is
        calculated by time-measurements contained in a CASTLE_RAW_DATA.
        
+       Data is taken from the last complete telemetry sample received from the ESC: the
+       function never waits for the ESC.
+
        @param [in] index indicates which ESC we want data for. First ESC index is 0
        @param [out] dataHolder is a pointer to a CASTLE_ESC_DATA structure to receive
        the data
-       @return 0 if data is not available, or a positive number otherwise
+       @return 0 if data is not available, CLL_DATA_NEW if the sample was never returned
+       before, CLL_DATA_OLD if it was already returned by a previous call
 
        @see CASTLE_RAW_DATA
+       @see getDataIfNew(uint8_t index, CASTLE_ESC_DATA *dataHolder)
    */
    uint8_t getData(uint8_t index, CASTLE_ESC_DATA *dataHolder);
    
    /** \brief Gets raw data (time measurements) for the index-ESC from the library.
 
+       Data is taken from the last complete telemetry sample received from the ESC: the
+       function never waits for the ESC.
+
        @param [in] index indicates which ESC we want data for. First ESC index is 0
        @param [out] dataHolder is a pointer to a CASTLE_RAW_DATA structure to receive
        the data
-       @return 0 if data is not available, or a positive number otherwise
+       @return 0 if data is not available, CLL_DATA_NEW if the sample was never returned
+       before, CLL_DATA_OLD if it was already returned by a previous call
 
        @see CASTLE_RAW_DATA
+       @see getDataIfNew(uint8_t index, CASTLE_RAW_DATA *dataHolder)
    */
    uint8_t getData(uint8_t index, CASTLE_RAW_DATA *dataHolder);
 
+   /** \brief Gets parsed data for the index-ESC from the library as scaled integers.
+
+       Same as getData(uint8_t index, CASTLE_ESC_DATA *dataHolder), but calculations
+       are done in fixed point (one 32 bit division per sample, no floating point)
+       and temperature from NTC sensor is read from a lookup table.
+       Results may differ from the floating point ones in the last digit.
+       Values are corrected by the calibration profile of the ESC, if any.
+
+       @param [in] index indicates which ESC we want data for. First ESC index is 0
+       @param [out] dataHolder is a pointer to a CASTLE_ESC_DATA_FX structure to receive
+       the data
+       @return 0 if data is not available, CLL_DATA_NEW if the sample was never returned
+       before, CLL_DATA_OLD if it was already returned by a previous call
+
+       @see CASTLE_ESC_DATA_FX
+   */
+   uint8_t getDataFixed(uint8_t index, CASTLE_ESC_DATA_FX *dataHolder);
+
+   /** \brief Same as getData(uint8_t index, CASTLE_ESC_DATA *dataHolder), but only
+       returns data if a new sample was received since last call for the same ESC.
+
+       @param [in] index indicates which ESC we want data for. First ESC index is 0
+       @param [out] dataHolder is a pointer to a CASTLE_ESC_DATA structure to receive
+       the data
+       @return 0 if no new data is available, or a positive number otherwise
+   */
+   uint8_t getDataIfNew(uint8_t index, CASTLE_ESC_DATA *dataHolder);
+
+   /** \brief Same as getData(uint8_t index, CASTLE_RAW_DATA *dataHolder), but only
+       returns data if a new sample was received since last call for the same ESC.
+
+       @param [in] index indicates which ESC we want data for. First ESC index is 0
+       @param [out] dataHolder is a pointer to a CASTLE_RAW_DATA structure to receive
+       the data
+       @return 0 if no new data is available, or a positive number otherwise
+   */
+   uint8_t getDataIfNew(uint8_t index, CASTLE_RAW_DATA *dataHolder);
+
+   /** \brief Same as getDataIfNew(uint8_t index, CASTLE_RAW_DATA *dataHolder), also returning
+       the sequence number of the sample.
+
+       Sequence number is incremented by the library at every sample completed for the ESC:
+       it goes from 1 to 255, then wraps to 1 (0 is never used). A gap between the sequence
+       numbers of two consecutive calls means samples were completed, but not read.
+
+       @param [in] index indicates which ESC we want data for. First ESC index is 0
+       @param [out] dataHolder is a pointer to a CASTLE_RAW_DATA structure to receive
+       the data
+       @param [out] seq receives the sequence number of the sample
+       @return 0 if no new data is available, or a positive number otherwise
+   */
+   uint8_t getDataIfNew(uint8_t index, CASTLE_RAW_DATA *dataHolder, uint8_t *seq);
+
+   /** \brief Gets raw data for several ESCs at once, all taken from the samples
+       last published as of the same telemetry window.
+
+       Calling getData(uint8_t index, CASTLE_RAW_DATA *dataHolder) for each ESC, a new
+       sample might be completed between two calls: data of the ESCs would then come
+       from different telemetry cycles.
+
+       @param [out] dataHolder is an array of CASTLE_RAW_DATA structures, indexed by ESC
+       index: it must have room up to the highest ESC in mask
+       @param [in] mask bitmask of ESCs to get data for (bit 0 for first ESC)
+       @return a bitmask of ESCs whose data is available (0 for none)
+
+       @see getData(uint8_t index, CASTLE_RAW_DATA *dataHolder)
+   */
+   uint8_t getDataAll(CASTLE_RAW_DATA *dataHolder, uint8_t mask);
+
+   /** \brief Same as getDataAll(CASTLE_RAW_DATA *dataHolder, uint8_t mask), returning
+       human-readable parsed data.
+
+       @param [out] dataHolder is an array of CASTLE_ESC_DATA structures, indexed by ESC
+       index: it must have room up to the highest ESC in mask
+       @param [in] mask bitmask of ESCs to get data for (bit 0 for first ESC)
+       @return a bitmask of ESCs whose data is available (0 for none)
+
+       @see getData(uint8_t index, CASTLE_ESC_DATA *dataHolder)
+   */
+   uint8_t getDataAll(CASTLE_ESC_DATA *dataHolder, uint8_t mask);
+
+#if (CLL_DEFERRED_HANDLERS != 0)
+   /** \brief Calls the data available handler for every ESC that completed a
+       sample since last call, available when CLL_DEFERRED_HANDLERS is set.
+
+       Handler receives a copy of the last sample of the ESC, so it can keep
+       the pointer only until it returns. If more than one sample was completed
+       for an ESC since last call, the handler is called once with the newest one.
+       Doesn't change what getDataIfNew(...) returns.
+
+       @return the number of handler calls
+       @see attachDataAvailableHandler
+   */
+   uint8_t poll();
+
+   /** \brief Returns a bitmask (bit N for ESC N) of ESCs with a pending
+       handler call, available when CLL_DEFERRED_HANDLERS is set.
+
+       Meant for checking, with interrupts disabled, if the program can sleep
+       waiting for an interrupt without delaying a pending handler call.
+   */
+   uint8_t handlersPending();
+#endif
+
+   /** \brief Puts the MCU in idle sleep mode until the library or the program has something to do.
+
+       Returns at once if an event is already pending. Otherwise sleeps in SLEEP_MODE_IDLE,
+       so timer, external and pin change interrupts keep timestamping ESC ticks exactly,
+       and the USART keeps receiving. ADC and analog comparator are powered down while
+       sleeping, unless CLL_SLEEP_ADC_OFF is 0; the first conversion after return is then
+       an extended one. Any other interrupt (i.e. Timer0 for millis()) is served as usual, then
+       the MCU goes back to sleep: sleeping ends only on CLL_EVENT_* events.
+
+       @param [in] wakeCheck optional program function, called with interrupts disabled before
+                   every sleep: non-zero ends sleeping (i.e. for a received serial byte).
+                   It must be short and must not enable interrupts.
+       A sample is reported as CLL_EVENT_DATA once, so programs with data available
+       handlers only, never calling getData, don't loop without sleeping.
+
+       @return a bitmask of CLL_EVENT_DATA, CLL_EVENT_HANDLER, CLL_EVENT_THROTTLE, CLL_EVENT_WAKE
+   */
+   uint8_t sleepUntilEvent(uint8_t (*wakeCheck)(void));
+
+   /** \brief Puts the MCU in idle sleep mode until the library has something to do.
+
+       Same as sleepUntilEvent(uint8_t (*wakeCheck)(void)) with no program wake check.
+   */
+   uint8_t sleepUntilEvent();
+
+#if (CLL_FREE_RUNNING_TIMER != 0)
+   /** \brief Schedules a callback on the library timer, available when CLL_FREE_RUNNING_TIMER is set.
+
+       callback is called once, from timer interrupt context, delay microseconds from now.
+       Called from the callback of the same slot, delay counts from when that callback was
+       due instead: rescheduling itself, a callback runs periodically without drifting
+       (i.e. to generate servo pulses). Callbacks share compare unit B with generated
+       throttle edges and run with interrupts disabled, so they must be short.
+       Works whether the throttle is armed or not.
+
+       @param [in] slot callback slot, from 0 to CLL_TIMER_SLOTS - 1: scheduling a pending slot again moves it
+       @param [in] delay delay in microseconds, up to CLL_TIMER_MAX_DELAY_US
+       @param [in] callback function to call, receiving the slot index
+       @return false if slot or delay are not valid
+   */
+   uint8_t setTimer(uint8_t slot, uint16_t delay, void (*callback)(uint8_t slot));
+
+   /** \brief Cancels the pending callback of a slot, available when CLL_FREE_RUNNING_TIMER is set.
+       @param [in] slot callback slot, from 0 to CLL_TIMER_SLOTS - 1
+       @see setTimer(uint8_t slot, uint16_t delay, void (*callback)(uint8_t slot))
+   */
+   void cancelTimer(uint8_t slot);
+#endif
+
+#if (CLL_PROFILE != 0)
+   /** \brief Returns the 32 bit timebase (timer ticks since begin, 0.5 us @ 16MHz),
+       available when CLL_PROFILE is set.
+   */
+   uint32_t getTimestamp();
+
+   /** \brief Copies profile histograms of an interrupt routine, available when CLL_PROFILE is set.
+       @param [in] isr interrupt routine index (CLL_PROF_COMPA, CLL_PROF_COMPB, CLL_PROF_ESC or CLL_PROF_THROTTLE)
+       @param [out] dataHolder is a pointer to a CLL_PROFILE_DATA structure to receive the histograms
+       @param [in] reset if true, histograms are cleared after being copied
+       @return false if isr is not valid
+       @see CLL_PROFILE_DATA
+   */
+   uint8_t getProfile(uint8_t isr, CLL_PROFILE_DATA *dataHolder, uint8_t reset);
+#endif
+
 #if (LED_DISABLE == 0)
    /** \brief Turns off or on Arduino led. If the throttle is armed the library
        controls the led and this function is silently ignored.
@@ -635,7 +1005,11 @@ class CastleLinkLiveLib {
    void _init_data_structure(int i);
    void _timer_init();
    uint8_t _setThrottlePinRegisters();
-   uint8_t _copyDataStructure(uint8_t index, CASTLE_RAW_DATA *dest);
+   uint8_t _snapshotDataStructure(uint8_t index, CASTLE_RAW_DATA *dest);
+   uint8_t _copyDataStructure(uint8_t index, CASTLE_RAW_DATA *dest, uint8_t *seqOut);
+   uint8_t _calcData(uint8_t index, CASTLE_RAW_DATA &c, CASTLE_ESC_DATA *o);
+   uint8_t _calcDataFixed(uint8_t index, CASTLE_RAW_DATA &c, CASTLE_ESC_DATA_FX *o);
+   uint8_t _calcDataCalibrated(uint8_t index, CASTLE_RAW_DATA &c, CASTLE_ESC_DATA *o);
 };
 
 /** \brief Global pre-istantiated object to be used by the program */
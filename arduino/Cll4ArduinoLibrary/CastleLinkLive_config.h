@@ -56,7 +56,9 @@
 /**
     By default, when generating throttle, CastleLinkLive will keep
     a period of 20ms (50Hz frequency).
-    Here you can override period duration (expressed in seconds)
+    Here you can override period duration (expressed in seconds).
+    CastleLinkLive also provides one version of begin function to set it
+    at runtime. Minimum period is THROTTLE_MAX + 6.5ms (telemetry window)
  */
 #define THROTTLEGEN_PERIOD 0.02f //20ms throttle period
 
@@ -76,6 +78,134 @@
 */
 #define THROTTLE_MAX 0.002f   // 2ms max
 
+/**
+    By default the number of ESC(s) is set at runtime by begin(...) and
+    interrupt routines read it, with related pin and interrupt masks, from
+    variables at every call.
+    Setting CLL_STATIC_NESC to a value from 1 to the max number of ESCs
+    supported by the board fixes it at compile time: interrupt routines are
+    specialised with constant masks and unrolled per-ESC code, lowering
+    latency and jitter. begin(...) will then fail if called with a different
+    number of ESC(s).
+    Leave it to 0 for runtime configuration.
+ */
+#define CLL_STATIC_NESC 0
+
+/**
+    By default ESC ticks are timestamped by reading the timer in the
+    external interrupt routine, so timestamps include a variable interrupt
+    latency (i.e. when another interrupt routine is running).
+    Setting CLL_ESC0_CAPTURE to a non-zero value makes the library use the
+    timer input capture unit for the first ESC instead: the tick edge is
+    latched by hardware. This requires the input capture pin to be wired
+    to the ESC0 pin (on ATmega168/328 Arduinos pin 8 to pin 2, on
+    ATmega32U4 pin 13 to pin 2 with LED_DISABLE set), and the input capture
+    pin cannot be used for other purposes.
+ */
+#define CLL_ESC0_CAPTURE 0
+
+/**
+    On ATmega168/328 Arduinos only INT0 and INT1 can be used as ESC inputs,
+    limiting the library to 2 ESCs. Setting CLL_PCINT_ESCS to a value from 1
+    to 6 adds as many ESC channels on PORTC pin-change interrupts: ESC2 on
+    pin A0, ESC3 on A1 and so on (so up to 8 ESCs). A single interrupt
+    routine timestamps all PORTC ESCs ticking at the same time with one
+    timer read. Throttle input can't be on PORTC pins then, and using A4
+    and A5 excludes I2C (Wire library).
+    Library state takes about 100 bytes of RAM per ESC: a program keeping
+    per-ESC state of its own can run out of the 2 KB of an ATmega328 first
+    (the serial monitor fits up to 5 ESCs, CLL_PCINT_ESCS 3).
+    Ignored on other MCUs.
+ */
+#define CLL_PCINT_ESCS 0
+
+/**
+    Setting CLL_PROFILE to a non-zero value builds the library with
+    interrupt routines instrumentation: the timer is extended to a 32 bit
+    timebase (see CastleLinkLiveLib::getTimestamp()) and every interrupt
+    routine records its entry latency and its duration into log2-bucket
+    histograms (see CastleLinkLiveLib::getProfile(...)).
+    Instrumentation adds a few microseconds to every interrupt routine:
+    leave it to 0 for normal use.
+ */
+#define CLL_PROFILE 0
+
+/**
+    Setting CLL_BENCHMARK to a non-zero value builds the library for
+    benchmarking without ESCs: at every throttle pulse end, when the
+    telemetry window opens, a synthetic Castle tick is fed to every ESC
+    data path, as if it was received by the external interrupt routine.
+    Ticks follow the regular telemetry sequence (reference, data frames,
+    then a reset frame), so a sample per ESC is published every 12
+    throttle periods: the rate is set by the throttle frame period.
+    Never use it with real ESCs connected.
+ */
+#define CLL_BENCHMARK 0
+
+/**
+    By default the data available handler (see
+    CastleLinkLiveLib::attachDataAvailableHandler(...)) is called by the
+    timer interrupt routine closing the telemetry cycle, so its duration
+    adds to the interrupt routine one and delays ESC ticks timestamping.
+    Setting CLL_DEFERRED_HANDLERS to a non-zero value makes the interrupt
+    routine only mark the ESC as pending: the handler is then called from
+    main context by CastleLinkLiveLib::poll(), which the program must call
+    often enough (i.e. at every loop), with a stable copy of the sample.
+ */
+#define CLL_DEFERRED_HANDLERS 0
+
+/**
+    By default the library owns its timer (Timer1, Timer3 on ATmega32U4):
+    the counter is cleared at every throttle edge and both compare units
+    are used, so other code can't share it.
+    Setting CLL_FREE_RUNNING_TIMER to a non-zero value leaves the counter
+    free running (normal mode, prescaler 8) and never writes it: the
+    telemetry window and generated throttle are timed by compare register
+    offsets and ticks are measured from throttle pulse end with wrapping
+    16 bit math. Compare unit B hosts a small scheduler of CLL_TIMER_SLOTS
+    callbacks (see CastleLinkLiveLib::setTimer(...)), interleaved with
+    generated throttle edges, for other timed outputs such as servo pulses.
+    The timer keeps running after throttleDisarm(). Other code may read
+    the counter, but must not write it nor change mode or prescaler, and
+    can't use compare units A and B.
+ */
+#define CLL_FREE_RUNNING_TIMER 0
+
+/**
+    Number of callback slots of the timer scheduler, when
+    CLL_FREE_RUNNING_TIMER is set (up to 8)
+ */
+#define CLL_TIMER_SLOTS 2
+
+/** \cond */
+#define CLL_THROTTLE_RUNTIME  0
+#define CLL_THROTTLE_GENERATE 1
+#define CLL_THROTTLE_EXTERNAL 2
+/** \endcond */
+
+/**
+    Like CLL_STATIC_NESC, fixes throttle mode at compile time:
+    CLL_THROTTLE_GENERATE for software generated throttle,
+    CLL_THROTTLE_EXTERNAL for external throttle signal, with throttle
+    bounds fixed to THROTTLE_MIN and THROTTLE_MAX.
+    Interrupt routines for the other mode are not compiled in, and
+    external throttle led calculations don't need floating point math.
+    begin(...) will then fail if called with a different throttle
+    mode or bounds.
+    Leave it to CLL_THROTTLE_RUNTIME for runtime configuration.
+ */
+#define CLL_STATIC_THROTTLE CLL_THROTTLE_RUNTIME
+
+/**
+    CastleLinkLiveLib::sleepUntilEvent(...) powers down ADC and analog
+    comparator while sleeping, and restores them on return. Re-enabling
+    the ADC makes the next conversion (i.e. by analogRead()) an extended
+    one, 25 ADC clock cycles instead of 13.
+    Set CLL_SLEEP_ADC_OFF to 0 to leave them as they are, i.e. when the
+    program runs ADC conversions in its own interrupt routines.
+ */
+#define CLL_SLEEP_ADC_OFF 1
+
 /**
     Since castle pins are externally pulled-up as required by castle link live spec,
     we need to keep disabled internal pullups when pins are used as inputs. We have two choices:
@@ -32,7 +32,11 @@
 #include "WProgram.h"
 #endif
 
-#define MAX_ESCS 2
+#if (CLL_PCINT_ESCS > 6)
+#error "CLL_PCINT_ESCS exceeds the number of PORTC pins (A0-A5)"
+#endif
+
+#define MAX_ESCS ( 2 + CLL_PCINT_ESCS )
 
 /***************************************
  * TIMER macros
@@ -68,6 +72,16 @@
 #define TIMER_IS_COMPB_ENABLED() ( TIMSK1 & _BV(OCIE1B) )
 #define TIMER_IS_OVF_ENABLED() ( TIMSK1 & _BV(TOIE1) )
 
+#define TIMER_GET_COMPA() OCR1A
+#define TIMER_GET_COMPB() OCR1B
+#define TIMER_IS_OVF_PENDING() ( TIFR1 & _BV(TOV1) )
+#define TIMER_IS_COMPB_PENDING() ( TIFR1 & _BV(OCF1B) )
+
+// interrupt flags are cleared writing them to 1
+#define TIMER_CLEAR_COMPA_PENDING() ( TIFR1 = _BV(OCF1A) )
+#define TIMER_CLEAR_COMPB_PENDING() ( TIFR1 = _BV(OCF1B) )
+#define TIMER_CLEAR_OVF_PENDING() ( TIFR1 = _BV(TOV1) )
+
 
 /***************************************
  * ESC PINs macros and config functions
@@ -82,28 +96,68 @@
 
 void configEscINTs(uint8_t nescs) {
 	EICRA |= _BV(ISC01);
-	if (nescs == 2)
+	if (nescs >= 2)
 		EICRA |= _BV(ISC11);
 }
 
-uint8_t getEscPinsMask(uint8_t nescs) {
+static inline uint8_t getEscPinsMask(uint8_t nescs) {
 	uint8_t ret = _BV(PORTD2);
-	if (nescs == 2) ret |= _BV(PORTD3);
+	if (nescs >= 2) ret |= _BV(PORTD3);
 	return ret;
 }
 
-uint8_t getEscIntClearMask(uint8_t nescs) {
+static inline uint8_t getEscIntClearMask(uint8_t nescs) {
 	uint8_t ret = _BV(INTF0);
-	if (nescs == 2) ret |= _BV(INTF1);
+	if (nescs >= 2) ret |= _BV(INTF1);
 	return ret;
 }
 
-uint8_t getEscIntEnableMask(uint8_t nescs) {
+static inline uint8_t getEscIntEnableMask(uint8_t nescs) {
 	uint8_t ret = _BV(INT0);
-	if (nescs == 2) ret |= _BV(INT1);
+	if (nescs >= 2) ret |= _BV(INT1);
 	return ret;
 }
 
+/***************************************
+ * PCINT ESC channels macros
+ * ESCs from the third on are on PORTC: ESC2 on A0 (PCINT8), ESC3 on A1
+ * and so on. They share PCINT1 vector, so throttle input can't be on PORTC
+ ***************************************/
+#if (CLL_PCINT_ESCS > 0)
+#define ESCX_FIRST 2 //index of ESC on PORTC bit 0
+
+#define ESCX_READ_PORT PINC
+#define ESCX_WRITE_PORT PORTC
+#define ESCX_DDR DDRC
+#define ESCX_PCMSK PCMSK1
+#define ESCX_THROTTLE_PORT PC
+
+#define ESCX_ISR PCINT1_vect
+
+//PCIFR is written, not or-ed: that would clear throttle pin change flag too
+#define ESCX_INT_ENABLE() ( PCIFR = _BV(PCIF1), PCICR |= _BV(PCIE1) )
+#define ESCX_INT_DISABLE() ( PCICR &= ~ _BV(PCIE1) )
+
+static inline uint8_t getEscxPinsMask(uint8_t nescs) {
+	if (nescs <= ESCX_FIRST) return 0;
+	return (uint8_t) ( _BV(nescs - ESCX_FIRST) - 1 );
+}
+#endif
+
+/***************************************
+ * ESC0 input capture macros
+ * ICP1 (PB0, pin 8) must be wired to ESC0 line (pin 2)
+ ***************************************/
+#define ESC_CAPTURE_PIN 8
+#define ESC_CAPTURE_ISR TIMER1_CAPT_vect
+#define ESC_CAPTURE_REG ICR1
+#define ESC_CAPTURE_INT_MASK _BV(INT0) //ESC0 external interrupt, replaced by capture
+
+#define ESC_CAPTURE_INIT() ( DDRB &= ~ _BV(DDB0), TCCR1B &= ~ _BV(ICES1) ) //input, falling edge
+//TIFR1 is written, not or-ed: that would clear pending compare flags too
+#define ESC_CAPTURE_ENABLE() ( TIFR1 = _BV(ICF1), TIMSK1 |= _BV(ICIE1) )
+#define ESC_CAPTURE_DISABLE() ( TIMSK1 &= ~ _BV(ICIE1) )
+
 
 /***************************************
  * LED macros
@@ -68,6 +68,16 @@
 #define TIMER_IS_COMPB_ENABLED() ( TIMSK3 & _BV(OCIE3B) )
 #define TIMER_IS_OVF_ENABLED() ( TIMSK3 & _BV(TOIE3) )
 
+#define TIMER_GET_COMPA() OCR3A
+#define TIMER_GET_COMPB() OCR3B
+#define TIMER_IS_OVF_PENDING() ( TIFR3 & _BV(TOV3) )
+#define TIMER_IS_COMPB_PENDING() ( TIFR3 & _BV(OCF3B) )
+
+// interrupt flags are cleared writing them to 1
+#define TIMER_CLEAR_COMPA_PENDING() ( TIFR3 = _BV(OCF3A) )
+#define TIMER_CLEAR_COMPB_PENDING() ( TIFR3 = _BV(OCF3B) )
+#define TIMER_CLEAR_OVF_PENDING() ( TIFR3 = _BV(TOV3) )
+
 /***************************************
  * ESC PINs macros
  ***************************************/
@@ -90,7 +100,7 @@ void configEscINTs(uint8_t nescs) {
 	if (nescs >= 5) EICRB |= 	_BV(ISC61); //pin 7
 }
 
-uint8_t getEscPinsMask(uint8_t nescs) {
+static inline uint8_t getEscPinsMask(uint8_t nescs) {
 	uint8_t ret = 			_BV(PORTD1); //pin 2
 	if (nescs >= 2) ret |= 	_BV(PORTD0); //pin 3
 	if (nescs >= 3) ret |= 	_BV(PORTD2); //pin 0
@@ -99,7 +109,7 @@ uint8_t getEscPinsMask(uint8_t nescs) {
 	return ret;
 }
 
-uint8_t getEscIntClearMask(uint8_t nescs) {
+static inline uint8_t getEscIntClearMask(uint8_t nescs) {
 	uint8_t ret = 			_BV(INTF1); //pin 2
 	if (nescs >= 2) ret |= 	_BV(INTF0); //pin 3
 	if (nescs >= 3) ret |= 	_BV(INTF2); //pin 0
@@ -108,7 +118,7 @@ uint8_t getEscIntClearMask(uint8_t nescs) {
 	return ret;
 }
 
-uint8_t getEscIntEnableMask(uint8_t nescs) {
+static inline uint8_t getEscIntEnableMask(uint8_t nescs) {
 	uint8_t ret = 			_BV(INT1); //pin 2
 	if (nescs >= 2) ret |= 	_BV(INT0); //pin 3
 	if (nescs >= 3) ret |= 	_BV(INT2); //pin 0
@@ -117,6 +127,21 @@ uint8_t getEscIntEnableMask(uint8_t nescs) {
 	return ret;
 }
 
+/***************************************
+ * ESC0 input capture macros
+ * ICP3 (PC7, pin 13) must be wired to ESC0 line (pin 2):
+ * it's the led pin, so led must be disabled
+ ***************************************/
+#define ESC_CAPTURE_PIN 13
+#define ESC_CAPTURE_ISR TIMER3_CAPT_vect
+#define ESC_CAPTURE_REG ICR3
+#define ESC_CAPTURE_INT_MASK _BV(INT1) //ESC0 external interrupt, replaced by capture
+
+#define ESC_CAPTURE_INIT() ( DDRC &= ~ _BV(DDC7), TCCR3B &= ~ _BV(ICES3) ) //input, falling edge
+//TIFR3 is written, not or-ed: that would clear pending compare flags too
+#define ESC_CAPTURE_ENABLE() ( TIFR3 = _BV(ICF3), TIMSK3 |= _BV(ICIE3) )
+#define ESC_CAPTURE_DISABLE() ( TIMSK3 &= ~ _BV(ICIE3) )
+
 
 /***************************************
  * LED macros
@@ -52,10 +52,24 @@ public class CLLCommProtocol {
 	/* DATA TYPES */
 	public static final int TYPE_ESCDATA = 0;
 	public static final int TYPE_RESPONSE = 1;
+	public static final int TYPE_INFO = 2;
+	public static final int TYPE_BATCH = 3;
 	
 	/* DATA TRANSMISSION HEADERS AND MASKS */
 	public static final int HEADER_DATAIN_H		    = 0xFF;
 	
+	/* compact data frames share the LS header byte with full data frames */
+	public static final int HEADER_COMPACT_H		= 0xFC;
+	
+	/* batch data frames: LS header byte as full data frames (ESC id unused),
+	 * ESC mask byte, full ticks of every ESC in mask, CRC-8 */
+	public static final int HEADER_BATCH_H			= 0xFD;
+	public static final int CRC8_POLY				= 0x07;
+	
+	/* CRC-16 CCITT (MSB first), used by CRCMODE_CRC16 */
+	public static final int CRC16_POLY				= 0x1021;
+	public static final int CRC16_INIT				= 0xFFFF;
+	
 	/* LS byte in header is actually header and data:
 	 *  bit 0-2: ESC id (1->7)
 	 *  bit 3  : external throttle presence (1 present, 0 not present/invalid)
@@ -72,6 +86,19 @@ public class CLLCommProtocol {
 	public static final int HEADER_RESPONSE_MASK	= 0xFE; // 1111 1110
 	public static final int RESPONSE_MASK			= 0x01; // 0000 0001
 	
+	/* tagged responses: HEADER_RESPONSE_H, HEADER_TAGGED_RESPONSE_L | tag << 1 | ACK/NACK bit */
+	public static final int HEADER_TAGGED_RESPONSE_L	= 0xB0; // 1011 0000
+	public static final int HEADER_TAGGED_RESPONSE_MASK	= 0xF0; // 1111 0000
+	public static final int RESPONSE_TAG_MASK		= 0x0E; // 0000 1110
+	public static final int RESPONSE_TAG_SHIFT		= 1;
+	
+	/* info frames: HEADER_RESPONSE_H, HEADER_INFO_L, info id, length, payload, checksum */
+	public static final int HEADER_INFO_L			= 0xA4; // 1010 0100
+	
+	/* INFO IDENTIFIERS */
+	public static final int INFO_STATS			= 0x01;
+	public static final int INFO_COUNTERS		= 0x03;
+	
 	public static final int OUT_HEADER			= 0x00;
 
 	/* COMMAND IDENTIFIERS */
@@ -85,21 +112,121 @@ public class CLLCommProtocol {
 	public static final int CMD_ARM				= 0x07;
 	public static final int CMD_SET_THROTTLE	= 0x08;
 	public static final int CMD_DISARM			= 0x09;
+	public static final int CMD_SET_DATAFMT		= 0x0A;
+	public static final int CMD_GET_STATS		= 0x0B;
+	public static final int CMD_RESET_STATS		= 0x0C;
+	public static final int CMD_GET_COUNTERS	= 0x0E;
+	public static final int CMD_SET_TPERIOD		= 0x0F;
+	public static final int CMD_SET_BAUD		= 0x10;
+	public static final int CMD_SET_CRC			= 0x11;
+	
+	/* tagged commands: tag (1 to CMD_TAG_CNT - 1) in command id bits 5-7, echoed in the response */
+	public static final int CMD_ID_MASK			= 0x1F;
+	public static final int CMD_TAG_SHIFT		= 5;
+	public static final int CMD_TAG_CNT			= 8;
+	
+	/* CHECK MODES: how frames and commands end (see CastleLinkLiveSerialMonitor protocol.h) */
+	public static final int CRCMODE_XOR			= 0x00; // XOR checksum (CRC-8 for batch frames)
+	public static final int CRCMODE_CRC8		= 0x01; // CRC-8 for frames and commands
+	public static final int CRCMODE_CRC16		= 0x02; // CRC-16 for frames, CRC-8 for commands
+	
+	/* BAUD RATES: CMD_SET_BAUD value is the index in BAUD_RATES */
+	public static final int[] BAUD_RATES		= { 38400, 250000, 500000, 1000000 };
+	/* ms the ESC interface waits for a HELLO at the new rate, before going back to the old one */
+	public static final int BAUD_CONFIRM_TIMEOUT	= 1000;
+	
+	/* STATS COMMANDS FLAGS AND VALUES */
+	public static final int STATS_READ_RESET	= 0x01; // in command MS byte
+	public static final int STATS_ALL_ESCS		= 0xFF;
+	
+	/* DATA FORMATS */
+	public static final int DATAFMT_FULL		= 0x00;
+	public static final int DATAFMT_COMPACT		= 0x01;
+	public static final int DATAFMT_NONE		= 0x02;
+	public static final int DATAFMT_BATCH		= 0x03;
+	
+	/* data format flag (in command MS byte): data frames carry a sequence byte */
+	public static final int DATAFMT_SEQUENCED	= 0x01;
+	
+	/* compact frame bitmap flag: values are absolute ticks, not deltas */
+	public static final int COMPACT_KEYFRAME	= 0x8000;
 	
 	/* RESPONSE ACK/NACK VALUES */
 	public static final int RESPONSE_ACK		= 0x01;
 	public static final int RESPONSE_NACK		= 0x00;
 	
 	
+	/* PARSER STATES */
+	private static final int S_HEADER_H			= 0;
+	private static final int S_HEADER_L			= 1;
+	private static final int S_FULL_DATA		= 2;
+	private static final int S_COMPACT_MAP		= 3;
+	private static final int S_COMPACT_DATA		= 4;
+	private static final int S_CHECKSUM			= 5;
+	private static final int S_INFO_ID			= 6;
+	private static final int S_INFO_LEN			= 7;
+	private static final int S_INFO_DATA		= 8;
+	private static final int S_BATCH_MASK		= 9;
+	private static final int S_BATCH_DATA		= 10;
+	private static final int S_SEQ				= 11;
+	private static final int S_CHECKSUM_L		= 12;
+	
+	private static final int MAX_ESC_ID = ESC_ID_MASK + 1;
+	
 	private int[] ticks = new int[DATA_FRAME_CNT];
 	private int type = TYPE_ESCDATA;
 	private int id = NO_ESC;
 	private int response;
+	private int responseTag;
 	private boolean throttlePresent = false;
 	
+	private int state = S_HEADER_H;
 	private int h_buffer;
 	private int cnt = 0;
 	private int checksum = 0;
+	private long checksumErrors = 0;
+	
+	/* frame being parsed */
+	private int[] work = new int[DATA_FRAME_CNT];
+	private int frameId;
+	private boolean frameThrottlePresent;
+	private boolean compact;
+	
+	/* compact frames decoding state */
+	private int bitmap;
+	private int frame;
+	private int varint;
+	private int varintShift;
+	private int[][] lastTicks = new int[MAX_ESC_ID][DATA_FRAME_CNT];
+	private boolean[] synced = new boolean[MAX_ESC_ID];
+	private int[] compactSeqs = new int[MAX_ESC_ID]; //sequence of last compact frame of each ESC
+	
+	/* info frames */
+	private int infoId;
+	private int infoLength;
+	private int[] info = new int[255];
+	private boolean infoFrame;
+	
+	/* frame check */
+	private int crcMode = CRCMODE_XOR;
+	private int crc;
+	private int crc16;
+	
+	/* batch frames */
+	private boolean batch;
+	private int batchMask;
+	private int batchLength;
+	private int[][] batchTicks = new int[MAX_ESC_ID][DATA_FRAME_CNT];
+	private int[] batchEscs = new int[MAX_ESC_ID];
+	private int batchEscCnt;
+	private int batchBlockSize;
+	
+	/* sequenced frames */
+	private boolean sequenced = false;
+	private int seq = -1;
+	private int frameSeq;
+	private int seqNextState;
+	private int[] batchSeqs = new int[MAX_ESC_ID];
 	
 	public int getTicks(int index) {
 		if (index >= 0 && index < DATA_FRAME_CNT)
@@ -108,50 +235,374 @@ public class CLLCommProtocol {
 			return -1;
 	}
 	
+	private static final int[] CRC8_TABLE = new int[256];
+	private static final int[] CRC16_TABLE = new int[256];
+	
+	static {
+		for (int i = 0; i < 256; i++) {
+			int c8 = i;
+			int c16 = i << 8;
+			for (int j = 0; j < 8; j++) {
+				c8 = ((c8 & 0x80) != 0) ? ((c8 << 1) ^ CRC8_POLY) & 0xFF : (c8 << 1) & 0xFF;
+				c16 = ((c16 & 0x8000) != 0) ? ((c16 << 1) ^ CRC16_POLY) & 0xFFFF : (c16 << 1) & 0xFFFF;
+			}
+			CRC8_TABLE[i] = c8;
+			CRC16_TABLE[i] = c16;
+		}
+	}
+	
+	/**
+	 * CRC-8 (MSB first) update, as used by batch frames and commands
+	 * @param crc current CRC value
+	 * @param b next byte
+	 * @return updated CRC value
+	 */
+	public static int crc8Update(int crc, int b) {
+		return CRC8_TABLE[(crc ^ b) & 0xFF];
+	}
+	
+	/**
+	 * CRC-16 CCITT (MSB first) update, as used by {@link CLLCommProtocol#CRCMODE_CRC16}.
+	 * Start from {@link CLLCommProtocol#CRC16_INIT}
+	 * @param crc current CRC value
+	 * @param b next byte
+	 * @return updated CRC value
+	 */
+	public static int crc16Update(int crc, int b) {
+		return ((crc << 8) & 0xFFFF) ^ CRC16_TABLE[((crc >> 8) ^ b) & 0xFF];
+	}
+	
+	/**
+	 * Updates all frame checks with a received byte
+	 * @param b
+	 */
+	private void checkByte(int b) {
+		checksum ^= b;
+		crc = crc8Update(crc, b);
+		crc16 = crc16Update(crc16, b);
+	}
+	
+	/**
+	 * Sets how frames are checked: must match the ESC interface setting
+	 * @param crcMode one of CRCMODE_* constants
+	 */
+	public void setCrcMode(int crcMode) {
+		this.crcMode = crcMode;
+	}
+	
+	/**
+	 * @return how frames are checked
+	 */
+	public int getCrcMode() {
+		return crcMode;
+	}
+	
+	/**
+	 * After a {@link CLLCommProtocol#TYPE_BATCH} frame is parsed, selects one of
+	 * the ESCs it contains: {@link CLLCommProtocol#getId()} and 
+	 * {@link CLLCommProtocol#getTicks(int)} will then return that ESC data
+	 * @param index 0-based index among ESCs in the batch (not ESC id)
+	 * @return false if index is out of batch
+	 */
+	public boolean selectBatchEsc(int index) {
+		if (index < 0 || index >= batchEscCnt) return false;
+		
+		id = batchEscs[index];
+		seq = sequenced ? batchSeqs[index] : -1;
+		System.arraycopy(batchTicks[index], 0, ticks, 0, DATA_FRAME_CNT);
+		return true;
+	}
+	
+	/**
+	 * Sets whether data frames carry a sequence byte ({@link CLLCommProtocol#DATAFMT_SEQUENCED}
+	 * flag of data format command). Must match the ESC interface setting.
+	 * @param sequenced
+	 */
+	public void setSequenced(boolean sequenced) {
+		this.sequenced = sequenced;
+	}
+	
+	/**
+	 * @return whether data frames are expected to carry a sequence byte
+	 */
+	public boolean isSequenced() {
+		return sequenced;
+	}
+	
+	/**
+	 * @return sequence number (0-255, rolling count of telemetry cycles completed 
+	 * by the ESC interface) of the ESC data parsed last, or -1 if frames are not
+	 * sequenced
+	 */
+	public int getSeq() {
+		return seq;
+	}
+	
+	/**
+	 * @return number of ESCs contained in last batch frame parsed
+	 */
+	public int getBatchEscCount() {
+		return batchEscCnt;
+	}
+	
+	/**
+	 * Moves compact frame decoding to next data frame present in bitmap,
+	 * or to checksum if no more frames are present 
+	 */
+	private void nextCompactFrame() {
+		varint = 0;
+		varintShift = 0;
+		
+		do {
+			frame++;
+		} while (frame < DATA_FRAME_CNT && (bitmap & (1 << frame)) == 0);
+		
+		state = (frame < DATA_FRAME_CNT) ? S_COMPACT_DATA : S_CHECKSUM;
+	}
+	
+	/**
+	 * Puts a byte received from the ESC interface in the parser
+	 * @param b received byte (only least significant byte is considered)
+	 * @return true if the byte completed a valid frame
+	 */
 	public boolean putByte(int b) {
 		b = b & 0xFF;
 
-		cnt++;
-		
-		if (cnt % 2 != 0) { //odd byte => MSB byte: save it for later
-			h_buffer = b;
-
-			if (cnt == DATA_FRAME_CNT * 2 + 3) { //DATA block completed
-				cnt = 0;
-				boolean checksum_ok = (checksum == h_buffer);
-				checksum = 0;
-				return checksum_ok;
-			}			
-		
-		} else {			// even byte => LSB byte: combine with buffer to get value
-			if (cnt == 2) {
-				if ( (h_buffer == HEADER_DATAIN_H) && (( b & HEADER_DATAIN_MASK ) == HEADER_DATAIN_L)) {
-					type = TYPE_ESCDATA;
-					id = (b & ESC_ID_MASK); //store the ESC id
-					throttlePresent = ( (b & THROTTLE_PRESENT_MASK) > 0 ); //store throttle presence
-					checksum = h_buffer;
-					checksum ^= b;
-				} else if ( (h_buffer == HEADER_RESPONSE_H) && ((b & HEADER_RESPONSE_MASK) == HEADER_RESPONSE_L) )  {
+		switch(state) {
+			case S_HEADER_H:
+				if (b == HEADER_DATAIN_H || b == HEADER_COMPACT_H || b == HEADER_BATCH_H || b == HEADER_RESPONSE_H) {
+					h_buffer = b;
+					checksum = b;
+					crc = crc8Update(0, b);
+					crc16 = crc16Update(CRC16_INIT, b);
+					state = S_HEADER_L;
+				}
+				return false;
+				
+			case S_HEADER_L:
+				if ( (h_buffer == HEADER_RESPONSE_H) && ((b & HEADER_RESPONSE_MASK) == HEADER_RESPONSE_L) )  {
 					type = TYPE_RESPONSE;
 					response = b & RESPONSE_MASK;
-					cnt = 0;
-					checksum = 0;
+					responseTag = 0;
+					state = S_HEADER_H;
 					return true;
-				} else { 
-					//reset sequence!
-					cnt = 0; 
-					checksum = 0;
+				} else if ( (h_buffer == HEADER_RESPONSE_H) && ((b & HEADER_TAGGED_RESPONSE_MASK) == HEADER_TAGGED_RESPONSE_L) )  {
+					type = TYPE_RESPONSE;
+					response = b & RESPONSE_MASK;
+					responseTag = (b & RESPONSE_TAG_MASK) >> RESPONSE_TAG_SHIFT;
+					state = S_HEADER_H;
+					return true;
+				} else if ( (h_buffer == HEADER_RESPONSE_H) && (b == HEADER_INFO_L) ) {
+					checkByte(b);
+					batch = false;
+					state = S_INFO_ID;
+					return false;
+				} else if ( (h_buffer != HEADER_RESPONSE_H) && (( b & HEADER_DATAIN_MASK ) == HEADER_DATAIN_L) ) {
+					frameId = (b & ESC_ID_MASK); //store the ESC id
+					frameThrottlePresent = ( (b & THROTTLE_PRESENT_MASK) > 0 ); //store throttle presence
+					compact = (h_buffer == HEADER_COMPACT_H);
+					batch = (h_buffer == HEADER_BATCH_H);
+					infoFrame = false;
+					checkByte(b);
+					cnt = 0;
+					
+					if (batch)
+						state = S_BATCH_MASK;
+					else
+						state = compact ? S_COMPACT_MAP : S_FULL_DATA;
+					
+					if (sequenced && ! batch) {
+						seqNextState = state;
+						state = S_SEQ;
+					}
 					return false;
 				}
-			} else {
-				checksum ^= h_buffer;
-				checksum ^= b;
-				ticks[cnt / 2 - 2] = (h_buffer << 8) + b;
-			}
+				
+				//reset sequence: this byte could be the start of a new one
+				state = S_HEADER_H;
+				return putByte(b);
+				
+			case S_SEQ:
+				checkByte(b);
+				frameSeq = b;
+				state = seqNextState;
+				return false;
+				
+			case S_FULL_DATA:
+				checkByte(b);
+				if (cnt % 2 == 0) //even byte => MSB byte: save it for later
+					h_buffer = b;
+				else //odd byte => LSB byte: combine with buffer to get value
+					work[cnt / 2] = (h_buffer << 8) + b;
+				
+				if (++cnt == DATA_FRAME_CNT * 2) state = S_CHECKSUM;
+				return false;
+				
+			case S_COMPACT_MAP:
+				checkByte(b);
+				if (cnt++ == 0) {
+					bitmap = b << 8;
+					return false;
+				}
+				
+				bitmap |= b;
+				
+				//unchanged frames keep last values
+				System.arraycopy(lastTicks[frameId], 0, work, 0, DATA_FRAME_CNT);
+				frame = -1;
+				nextCompactFrame();
+				return false;
+				
+			case S_COMPACT_DATA:
+				checkByte(b);
+				varint |= (b & 0x7F) << varintShift;
+				varintShift += 7;
+				
+				if ((b & 0x80) != 0) { 
+					if (varintShift > 14) { //too long: corrupted frame
+						synced[frameId] = false; //we don't know what we lost: wait for next keyframe
+						state = S_HEADER_H;
+					}
+					return false;
+				}
+				
+				if ((bitmap & COMPACT_KEYFRAME) != 0)
+					work[frame] = varint & 0xFFFF;
+				else
+					work[frame] = (work[frame] + ((varint >>> 1) ^ -(varint & 1))) & 0xFFFF; //zig-zag decode
+				
+				nextCompactFrame();
+				return false;
+				
+			case S_BATCH_MASK:
+				checkByte(b);
+				batchMask = b;
+				batchEscCnt = 0;
+				for (int e = 0; e < MAX_ESC_ID; e++)
+					if ((batchMask & (1 << e)) != 0) batchEscs[batchEscCnt++] = e;
+				
+				batchBlockSize = DATA_FRAME_CNT * 2 + (sequenced ? 1 : 0);
+				batchLength = batchEscCnt * batchBlockSize;
+				state = (batchLength > 0) ? S_BATCH_DATA : S_CHECKSUM;
+				return false;
+				
+			case S_BATCH_DATA:
+				checkByte(b);
+				int blockEsc = cnt / batchBlockSize;
+				int k = cnt % batchBlockSize;
+				
+				if (sequenced) {
+					if (k == 0) {
+						batchSeqs[blockEsc] = b; //sequence byte precedes ticks of each ESC
+						cnt++;
+						return false;
+					}
+					k--;
+				}
+				
+				if (k % 2 == 0) //even byte => MSB byte: save it for later
+					h_buffer = b;
+				else
+					batchTicks[blockEsc][k / 2] = (h_buffer << 8) + b;
+				
+				if (++cnt == batchLength) state = S_CHECKSUM;
+				return false;
+				
+			case S_INFO_ID:
+				checkByte(b);
+				infoId = b;
+				state = S_INFO_LEN;
+				return false;
+				
+			case S_INFO_LEN:
+				checkByte(b);
+				infoLength = b;
+				infoFrame = true;
+				cnt = 0;
+				state = (infoLength > 0) ? S_INFO_DATA : S_CHECKSUM;
+				return false;
+				
+			case S_INFO_DATA:
+				checkByte(b);
+				info[cnt++] = b;
+				if (cnt == infoLength) state = S_CHECKSUM;
+				return false;
+				
+			case S_CHECKSUM:
+				if (crcMode == CRCMODE_CRC16) {
+					h_buffer = b;
+					state = S_CHECKSUM_L;
+					return false;
+				}
+				
+				state = S_HEADER_H;
+				if (crcMode == CRCMODE_CRC8 || batch)
+					return frameCompleted(crc == b);
+				else
+					return frameCompleted(checksum == b);
+				
+			case S_CHECKSUM_L:
+				state = S_HEADER_H;
+				return frameCompleted(crc16 == ((h_buffer << 8) | b));
 		}
 		
 		return false;
 	}
+	
+	/**
+	 * Called when the check of a frame is received
+	 * @param valid whether the check matched
+	 * @return true if frame was valid and completed
+	 */
+	private boolean frameCompleted(boolean valid) {
+		if (infoFrame) {
+			infoFrame = false;
+			if (! valid) {
+				checksumErrors++;
+				return false;
+			}
+			type = TYPE_INFO;
+			return true;
+		}
+		
+		if (batch) {
+			batch = false;
+			if (! valid) {
+				checksumErrors++;
+				return false;
+			}
+			type = TYPE_BATCH;
+			throttlePresent = frameThrottlePresent;
+			return true;
+		}
+		
+		if (! valid) {
+			checksumErrors++;
+			//we don't know what we lost: wait for next keyframe
+			if (compact) synced[frameId] = false;
+			return false;
+		}
+		
+		if (compact) {
+			if ((bitmap & COMPACT_KEYFRAME) != 0) 
+				synced[frameId] = true;
+			else if (sequenced && frameSeq != ((compactSeqs[frameId] + 1) & 0xFF))
+				synced[frameId] = false; //sequence gap: a frame may be lost on the wire
+			
+			if (! synced[frameId])
+				return false; //deltas from unknown values
+			
+			compactSeqs[frameId] = frameSeq;
+			System.arraycopy(work, 0, lastTicks[frameId], 0, DATA_FRAME_CNT);
+		}
+		
+		System.arraycopy(work, 0, ticks, 0, DATA_FRAME_CNT);
+		type = TYPE_ESCDATA;
+		id = frameId;
+		seq = sequenced ? frameSeq : -1;
+		throttlePresent = frameThrottlePresent;
+		return true;
+	}
 
 	/**
 	 * @return the 0-based index of the ESC whose data is parsed last
@@ -175,11 +626,77 @@ public class CLLCommProtocol {
 		return response;
 	}
 
+	/**
+	 * @return tag of last response received from the ESC interface, 0 if it was untagged
+	 */
+	public int getResponseTag() {
+		return responseTag;
+	}
+
+	/**
+	 * @return the identifier of last info frame received (i.e. {@link CLLCommProtocol#INFO_STATS})
+	 */
+	public int getInfoId() {
+		return infoId;
+	}
+
+	/**
+	 * @return payload length of last info frame received
+	 */
+	public int getInfoLength() {
+		return infoLength;
+	}
+
+	/**
+	 * @param index 0-based byte index in last info frame payload
+	 * @return the payload byte, or -1 if index is out of payload
+	 */
+	public int getInfoByte(int index) {
+		if (index >= 0 && index < infoLength)
+			return info[index];
+		else
+			return -1;
+	}
+
+	/**
+	 * @param index 0-based byte index in last info frame payload
+	 * @return the 16 bit value (MS byte first) at index in payload, or -1 if
+	 * index is out of payload
+	 */
+	public int getInfoWord(int index) {
+		if (index >= 0 && index + 1 < infoLength)
+			return (info[index] << 8) + info[index + 1];
+		else
+			return -1;
+	}
+
+	/**
+	 * @param index 0-based byte index in last info frame payload
+	 * @return the 32 bit value (MS byte first) at index in payload, or -1 if
+	 * index is out of payload
+	 */
+	public long getInfoLong(int index) {
+		if (index >= 0 && index + 3 < infoLength)
+			return ((long) getInfoWord(index) << 16) + getInfoWord(index + 2);
+		else
+			return -1;
+	}
+	
+	/**
+	 * @return number of frames discarded because of a wrong checksum or CRC
+	 * since this parser was created
+	 */
+	public long getChecksumErrors() {
+		return checksumErrors;
+	}
+
 	/**
 	 * @return the type of data the parser finished parsing last: 
-	 * {@link CLLCommProtocol#TYPE_ESCDATA} if data was ESC telemetry data or
+	 * {@link CLLCommProtocol#TYPE_ESCDATA} if data was ESC telemetry data,
 	 * {@link CLLCommProtocol#TYPE_RESPONSE} if data was a response to a previously
-	 * issued command
+	 * issued command, {@link CLLCommProtocol#TYPE_INFO} if data was an info frame
+	 * requested by a previously issued command or {@link CLLCommProtocol#TYPE_BATCH}
+	 * if data was ESC telemetry data for more ESCs (see {@link CLLCommProtocol#selectBatchEsc(int)})
 	 * @see CastleLinkLive 
 	 */
 	public int getType() {
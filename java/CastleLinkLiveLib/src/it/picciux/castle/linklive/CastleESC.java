@@ -52,6 +52,8 @@ public class CastleESC {
 	private double temperature;
 	private int rpmDivider = 1;
 	private boolean updated = false;
+	private int[] ticks = new int[CLLCommProtocol.DATA_FRAME_CNT];
+	private CastleESCStats stats = new CastleESCStats();
 	
 	//private static Logger log = Logger.getLogger("it.picciux.castle.linklive.castleesc");
 	
@@ -163,6 +165,63 @@ public class CastleESC {
 		return temperature;
 	}
 
+	/**
+	 * @param frame data frame identifier (i.e. {@link CLLCommProtocol#FRAME_VOLTAGE})
+	 * @return raw ticks of the data frame in the last sample parsed
+	 * @see CastleESCColumns
+	 */
+	public int getTicks(int frame) {
+		return ticks[frame];
+	}
+
+	/**
+	 * @return telemetry statistics computed by the ESC interface, as
+	 * last requested with {@link CastleLinkLive#requestStats(int, boolean)}
+	 */
+	public CastleESCStats getStats() {
+		return stats;
+	}
+
+	/**
+	 * Calculates a telemetry value from its base value (ticks minus offset,
+	 * divided by reference ticks) 
+	 * @param frame data frame identifier (i.e. {@link CLLCommProtocol#FRAME_VOLTAGE})
+	 * @param value base value
+	 * @return telemetry value in the same unit returned by the corresponding getter
+	 * (output power as a percentage)
+	 */
+	static double calcValue(int frame, double value) {
+		switch(frame) {
+			case CLLCommProtocol.FRAME_VOLTAGE:
+				return value * 20.0d;
+			case CLLCommProtocol.FRAME_RIPPLE_VOLTAGE:
+				return value * 4.0d;
+			case CLLCommProtocol.FRAME_CURRENT:
+				return value * 50.0d;
+			case CLLCommProtocol.FRAME_THROTTLE:
+				return value;
+			case CLLCommProtocol.FRAME_OUTPUT_POWER:
+				return value * 0.2502d * 100.0d;
+			case CLLCommProtocol.FRAME_RPM:
+				return value * 20416.7d;
+			case CLLCommProtocol.FRAME_BEC_VOLTAGE:
+				return value * 4.0d;
+			case CLLCommProtocol.FRAME_BEC_CURRENT:
+				return value * 4.0d;
+			case CLLCommProtocol.FRAME_TEMP1:
+				return value * 30.0d;
+			case CLLCommProtocol.FRAME_TEMP2:
+				if (value > 3.9d) 
+					return -40;
+				else {
+					double d = value * 63.8125d;
+					return 1.0d / (Math.log(d * 10200d / (255 - d) / 10000.0d) / 3455.0d + 1.0d / 298.0d) - 273;
+				}
+			default:
+				return value;
+		}
+	}
+	
 	private double checkValue(double oldVal, double newVal) {
 		if (oldVal != newVal) {
 			updated = true;
@@ -207,6 +266,9 @@ public class CastleESC {
 		
 		updated = false;
 
+		for (int f = 0; f < CLLCommProtocol.DATA_FRAME_CNT; f++)
+			ticks[f] = data.getTicks(f);
+
 		for (int f = 1; f < CLLCommProtocol.DATA_FRAME_CNT; f++) {
 			int ticks = data.getTicks(f);
 			
@@ -220,41 +282,36 @@ public class CastleESC {
 			
 			switch(f) {
 				case CLLCommProtocol.FRAME_VOLTAGE:
-					voltage = checkValue(voltage, value * 20.0d);
+					voltage = checkValue(voltage, calcValue(f, value));
 					break;
 				case CLLCommProtocol.FRAME_RIPPLE_VOLTAGE:
-					rippleVoltage = checkValue(rippleVoltage, value * 4.0d);
+					rippleVoltage = checkValue(rippleVoltage, calcValue(f, value));
 					break;
 				case CLLCommProtocol.FRAME_CURRENT:
-					current = checkValue(current, value * 50.0d);
+					current = checkValue(current, calcValue(f, value));
 					break;
 				case CLLCommProtocol.FRAME_THROTTLE:
-					throttle = checkValue(current, value);
+					throttle = checkValue(current, calcValue(f, value));
 					break;
 				case CLLCommProtocol.FRAME_OUTPUT_POWER:
-					outputPower = checkValue(outputPower, (int) Math.round(value * 0.2502d * 100.0d));
+					outputPower = checkValue(outputPower, (int) Math.round(calcValue(f, value)));
 					break;
 				case CLLCommProtocol.FRAME_RPM:
-					electricalRPM = checkValue(electricalRPM, Math.round(value * 20416.7d));
+					electricalRPM = checkValue(electricalRPM, Math.round(calcValue(f, value)));
 					break;
 				case CLLCommProtocol.FRAME_BEC_VOLTAGE:
-					BECvoltage = checkValue(BECvoltage, value * 4.0d);
+					BECvoltage = checkValue(BECvoltage, calcValue(f, value));
 					break;
 				case CLLCommProtocol.FRAME_BEC_CURRENT:
-					BECcurrent = checkValue(BECcurrent, value * 4.0d);
+					BECcurrent = checkValue(BECcurrent, calcValue(f, value));
 					break;
 				case CLLCommProtocol.FRAME_TEMP1:
 					temp1Ticks = ticks;
-					temperature = checkValue(temperature, value * 30.0d);
+					temperature = checkValue(temperature, calcValue(f, value));
 					break;
 				case CLLCommProtocol.FRAME_TEMP2:
 					if (ticks > temp1Ticks) {
-						if (value > 3.9d) 
-							temperature = checkValue(temperature, -40);
-						else {
-							double d = value * 63.8125d;
-							temperature = checkValue(temperature, 1.0d / (Math.log(d * 10200d / (255 - d) / 10000.0d) / 3455.0d + 1.0d / 298.0d) - 273);
-						}
+						temperature = checkValue(temperature, calcValue(f, value));
 					}
 					break;
 			}
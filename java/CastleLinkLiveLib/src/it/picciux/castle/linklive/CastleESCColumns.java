@@ -0,0 +1,345 @@
+/*****************************************************************************
+ *  CastleLinkLive library - CastleESCColumns.java
+ *  Copyright (C) 2026  CastleLinkLive contributors
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  For further info, check http://code.google.com/p/castlelinklive4arduino/
+ *
+ *  SVN: $Id$
+ *  
+ *****************************************************************************/
+
+package it.picciux.castle.linklive;
+
+import java.io.BufferedInputStream;
+import java.io.BufferedOutputStream;
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.EOFException;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.util.zip.Deflater;
+import java.util.zip.DeflaterOutputStream;
+import java.util.zip.InflaterInputStream;
+
+/**
+ * A chunk of telemetry samples of a Castle Creations ESC, stored by columns:
+ * an array of raw ticks for every data frame plus an array of timestamps.
+ * Chunks are the unit of binary columnar logs (see {@link #write(DataOutputStream)}
+ * and {@link #read(DataInputStream)}), and whole columns are converted to
+ * telemetry values at once by the decode methods, with the same math as
+ * {@link CastleESC#parseData(CLLCommProtocol)}.
+ * <p>
+ * A columnar log is a sequence of chunks, each one made of: {@link #MAGIC} (4 bytes),
+ * {@link #VERSION} (1), ESC index (1), sample count (4), timestamp of first sample
+ * (8, ms), payload length (4) and payload, compressed with {@link Deflater}.
+ * Uncompressed payload holds timestamps as deltas from previous sample, then
+ * every data frame column, from {@link CLLCommProtocol#FRAME_REFERENCE}, as deltas
+ * from previous sample ticks. All deltas are zig-zag encoded little-endian base-128
+ * varints, as in compact data frames: ticks change slowly, so most take one byte
+ * and compress well.
+ *
+ * @see CastleESC#getTicks(int)
+ */
+public class CastleESCColumns {
+	/** chunk header: "CLLC" */
+	public static final int MAGIC = 0x434C4C43;
+	public static final int VERSION = 1;
+	public static final int DEFAULT_CAPACITY = 4096;
+
+	private int index;
+	private int size = 0;
+	private long[] timestamps;
+	private int[][] ticks;
+
+	/**
+	 * Class Constructor: a chunk of {@link #DEFAULT_CAPACITY} samples
+	 * @param index ESC index
+	 */
+	public CastleESCColumns(int index) {
+		this(index, DEFAULT_CAPACITY);
+	}
+
+	/**
+	 * Class Constructor
+	 * @param index ESC index
+	 * @param capacity maximum number of samples in the chunk
+	 */
+	public CastleESCColumns(int index, int capacity) {
+		this.index = index;
+		timestamps = new long[capacity];
+		ticks = new int[CLLCommProtocol.DATA_FRAME_CNT][capacity];
+	}
+
+	/**
+	 * @return the ESC index samples belong to
+	 */
+	public int getIndex() {
+		return index;
+	}
+
+	/**
+	 * @return number of samples in the chunk
+	 */
+	public int getSize() {
+		return size;
+	}
+
+	/**
+	 * @return maximum number of samples in the chunk
+	 */
+	public int getCapacity() {
+		return timestamps.length;
+	}
+
+	/**
+	 * @return true if no more samples can be added
+	 */
+	public boolean isFull() {
+		return size == timestamps.length;
+	}
+
+	/**
+	 * Removes all samples
+	 */
+	public void clear() {
+		size = 0;
+	}
+
+	/**
+	 * Appends the last sample parsed by an ESC
+	 * @param timestamp sample timestamp (ms)
+	 * @param esc the ESC
+	 * @return false if the chunk is full and the sample was not added
+	 */
+	public boolean add(long timestamp, CastleESC esc) {
+		if (isFull()) return false;
+
+		timestamps[size] = timestamp;
+		for (int f = 0; f < CLLCommProtocol.DATA_FRAME_CNT; f++)
+			ticks[f][size] = esc.getTicks(f);
+
+		size++;
+		return true;
+	}
+
+	/**
+	 * @param sample sample index, from 0 to {@link #getSize()} - 1
+	 * @return sample timestamp (ms)
+	 */
+	public long getTimestamp(int sample) {
+		return timestamps[sample];
+	}
+
+	/**
+	 * @param frame data frame identifier (i.e. {@link CLLCommProtocol#FRAME_VOLTAGE})
+	 * @param sample sample index, from 0 to {@link #getSize()} - 1
+	 * @return raw ticks of the data frame in the sample
+	 */
+	public int getTicks(int frame, int sample) {
+		return ticks[frame][sample];
+	}
+
+	/**
+	 * Telemetry values of a data frame for all samples: as {@link CastleESC}
+	 * does, a sample with no ticks for the frame (or no reference) repeats
+	 * previous value. Output power is a percentage and RPM is electrical,
+	 * both not rounded.
+	 * @param frame data frame identifier, from {@link CLLCommProtocol#FRAME_VOLTAGE}
+	 * to {@link CLLCommProtocol#FRAME_TEMP2}
+	 * @param out array of at least {@link #getSize()} values, in the same unit returned
+	 * by the corresponding CastleESC getter
+	 */
+	public void decode(int frame, double[] out) {
+		int[] t = ticks[frame];
+		int[] ref = ticks[CLLCommProtocol.FRAME_REFERENCE];
+		int[] t1 = ticks[CLLCommProtocol.FRAME_TEMP1];
+		int[] t2 = ticks[CLLCommProtocol.FRAME_TEMP2];
+		double last = 0;
+
+		if (frame == CLLCommProtocol.FRAME_TEMP2) { //not linear
+			for (int i = 0; i < size; i++) {
+				if (t[i] != 0 && ref[i] != 0)
+					last = CastleESC.calcValue(frame, ((double) (t[i] - Math.min(t1[i], t2[i]))) / ((double) ref[i]));
+				out[i] = last;
+			}
+			return;
+		}
+
+		double scale = CastleESC.calcValue(frame, 1.0d);
+
+		for (int i = 0; i < size; i++) {
+			if (t[i] != 0 && ref[i] != 0)
+				last = ((double) (t[i] - Math.min(t1[i], t2[i]))) / ((double) ref[i]) * scale;
+			out[i] = last;
+		}
+	}
+
+	/**
+	 * @param frame data frame identifier
+	 * @return a new array with telemetry values of a data frame for all samples
+	 * @see #decode(int, double[])
+	 */
+	public double[] decode(int frame) {
+		double[] out = new double[size];
+		decode(frame, out);
+		return out;
+	}
+
+	/**
+	 * ESC temperature for all samples, as returned by {@link CastleESC#getTemperature()}:
+	 * from {@link CLLCommProtocol#FRAME_TEMP2} when its ticks are above
+	 * {@link CLLCommProtocol#FRAME_TEMP1} ones, from FRAME_TEMP1 otherwise
+	 * @param out array of at least {@link #getSize()} values (degree Celsius)
+	 */
+	public void decodeTemperature(double[] out) {
+		double[] v1 = decode(CLLCommProtocol.FRAME_TEMP1);
+		double[] v2 = decode(CLLCommProtocol.FRAME_TEMP2);
+		int[] t1 = ticks[CLLCommProtocol.FRAME_TEMP1];
+		int[] t2 = ticks[CLLCommProtocol.FRAME_TEMP2];
+
+		for (int i = 0; i < size; i++)
+			out[i] = (t2[i] > t1[i]) ? v2[i] : v1[i];
+	}
+
+	private static void putVarint(OutputStream out, long v) throws IOException {
+		while ((v & ~0x7FL) != 0) {
+			out.write((int) ((v & 0x7F) | 0x80));
+			v >>>= 7;
+		}
+		out.write((int) v);
+	}
+
+	private static long getVarint(InputStream in) throws IOException {
+		long v = 0;
+
+		for (int shift = 0; shift < 64; shift += 7) {
+			int b = in.read();
+			if (b < 0) throw new EOFException("Truncated columnar log chunk");
+			v |= ((long) (b & 0x7F)) << shift;
+			if ((b & 0x80) == 0) return v;
+		}
+
+		throw new IOException("Invalid varint in columnar log chunk");
+	}
+
+	private static long zigzag(long v) {
+		return (v << 1) ^ (v >> 63);
+	}
+
+	private static long unzigzag(long v) {
+		return (v >>> 1) ^ -(v & 1);
+	}
+
+	/**
+	 * Writes the chunk to a columnar log
+	 * @param out log stream
+	 * @throws IOException if writing fails
+	 */
+	public void write(DataOutputStream out) throws IOException {
+		ByteArrayOutputStream payload = new ByteArrayOutputStream(size * CLLCommProtocol.DATA_FRAME_CNT / 2 + 64);
+		Deflater deflater = new Deflater(Deflater.BEST_COMPRESSION);
+		OutputStream z = new BufferedOutputStream(new DeflaterOutputStream(payload, deflater));
+		long first = (size > 0) ? timestamps[0] : 0;
+
+		try {
+			long prev = first;
+			for (int i = 0; i < size; i++) {
+				putVarint(z, zigzag(timestamps[i] - prev));
+				prev = timestamps[i];
+			}
+
+			for (int f = 0; f < CLLCommProtocol.DATA_FRAME_CNT; f++) {
+				int[] t = ticks[f];
+				int p = 0;
+				for (int i = 0; i < size; i++) {
+					putVarint(z, zigzag(t[i] - p));
+					p = t[i];
+				}
+			}
+
+			z.close();
+		} finally {
+			deflater.end();
+		}
+
+		out.writeInt(MAGIC);
+		out.writeByte(VERSION);
+		out.writeByte(index);
+		out.writeInt(size);
+		out.writeLong(first);
+		out.writeInt(payload.size());
+		payload.writeTo(out);
+	}
+
+	/**
+	 * Reads next chunk from a columnar log
+	 * @param in log stream
+	 * @return the chunk, or null at end of log
+	 * @throws IOException if reading fails or the log is truncated
+	 * @throws InvalidDataException if the stream is not a valid columnar log
+	 */
+	public static CastleESCColumns read(DataInputStream in) throws IOException, InvalidDataException {
+		int magic;
+
+		try {
+			magic = in.readInt();
+		} catch (EOFException e) {
+			return null; //end of log between chunks
+		}
+
+		if (magic != MAGIC) throw new InvalidDataException("Invalid columnar log: wrong chunk header");
+
+		int version = in.readUnsignedByte();
+		if (version != VERSION) throw new InvalidDataException("Invalid columnar log: unknown version " + version);
+
+		int index = in.readUnsignedByte();
+		int size = in.readInt();
+		long prev = in.readLong();
+		int length = in.readInt();
+
+		if (size < 0 || length < 0) throw new InvalidDataException("Invalid columnar log: wrong chunk size");
+
+		byte[] payload = new byte[length];
+		in.readFully(payload);
+
+		CastleESCColumns c = new CastleESCColumns(index, size);
+		InputStream z = new BufferedInputStream(new InflaterInputStream(new ByteArrayInputStream(payload)));
+
+		try {
+			for (int i = 0; i < size; i++) {
+				prev += unzigzag(getVarint(z));
+				c.timestamps[i] = prev;
+			}
+
+			for (int f = 0; f < CLLCommProtocol.DATA_FRAME_CNT; f++) {
+				int[] t = c.ticks[f];
+				int p = 0;
+				for (int i = 0; i < size; i++) {
+					p += (int) unzigzag(getVarint(z));
+					t[i] = p;
+				}
+			}
+		} finally {
+			z.close();
+		}
+
+		c.size = size;
+		return c;
+	}
+}
@@ -0,0 +1,172 @@
+/*****************************************************************************
+ *  CastleLinkLive library - CastleESCStats.java
+ *  Copyright (C) 2026  CastleLinkLive contributors
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  For further info, check http://code.google.com/p/castlelinklive4arduino/
+ *
+ *  SVN: $Id$
+ *  
+ *****************************************************************************/
+
+package it.picciux.castle.linklive;
+
+/**
+ * Telemetry statistics of a Castle Creations ESC, as computed by the
+ * ESC interface over all telemetry samples received since last reset:
+ * minimum, maximum, mean and exponentially weighted moving average
+ * for every data frame.
+ * Objects of this class are held by {@link CastleESC} objects and are
+ * updated when the ESC interface answers to {@link CastleLinkLive#requestStats(int, boolean)}
+ * 
+ * @see CastleESC#getStats()
+ * @see ICastleLinkLiveEvent#statsUpdated(int, CastleESC)
+ */
+public class CastleESCStats {
+	private int count = 0;
+	private int[] min = new int[CLLCommProtocol.DATA_FRAME_CNT];
+	private int[] max = new int[CLLCommProtocol.DATA_FRAME_CNT];
+	private int[] mean = new int[CLLCommProtocol.DATA_FRAME_CNT];
+	private int[] ewma = new int[CLLCommProtocol.DATA_FRAME_CNT];
+	
+	/* payload layout */
+	private static final int COUNT_OFFSET = 1;
+	private static final int FRAMES_OFFSET = 3;
+	private static final int FRAME_SIZE = 8;
+	
+	/**
+	 * Reads statistics from an {@link CLLCommProtocol#INFO_STATS} info frame
+	 * @param data a CLLCommProtocol object which parsed the info frame
+	 * @throws InvalidDataException if the info frame is not valid
+	 */
+	void parse(CLLCommProtocol data) throws InvalidDataException {
+		if (data.getInfoLength() != FRAMES_OFFSET + FRAME_SIZE * CLLCommProtocol.DATA_FRAME_CNT)
+			throw new InvalidDataException("Invalid stats: wrong length " + data.getInfoLength());
+		
+		count = data.getInfoWord(COUNT_OFFSET);
+		
+		for (int f = 0; f < CLLCommProtocol.DATA_FRAME_CNT; f++) {
+			int base = FRAMES_OFFSET + f * FRAME_SIZE;
+			min[f] = data.getInfoWord(base);
+			max[f] = data.getInfoWord(base + 2);
+			mean[f] = data.getInfoWord(base + 4);
+			ewma[f] = data.getInfoWord(base + 6);
+		}
+	}
+	
+	/**
+	 * @return number of telemetry samples statistics are computed on
+	 * (saturates at 65535)
+	 */
+	public int getCount() {
+		return count;
+	}
+	
+	/**
+	 * @param frame data frame identifier (i.e. {@link CLLCommProtocol#FRAME_VOLTAGE})
+	 * @return minimum ticks measured for the data frame
+	 */
+	public int getMinTicks(int frame) {
+		return min[frame];
+	}
+
+	/**
+	 * @param frame data frame identifier (i.e. {@link CLLCommProtocol#FRAME_VOLTAGE})
+	 * @return maximum ticks measured for the data frame
+	 */
+	public int getMaxTicks(int frame) {
+		return max[frame];
+	}
+
+	/**
+	 * @param frame data frame identifier (i.e. {@link CLLCommProtocol#FRAME_VOLTAGE})
+	 * @return mean ticks measured for the data frame
+	 */
+	public int getMeanTicks(int frame) {
+		return mean[frame];
+	}
+
+	/**
+	 * @param frame data frame identifier (i.e. {@link CLLCommProtocol#FRAME_VOLTAGE})
+	 * @return exponentially weighted moving average of ticks measured for the data frame
+	 */
+	public int getEwmaTicks(int frame) {
+		return ewma[frame];
+	}
+	
+	/**
+	 * @return the temperature data frame the ESC is reporting:
+	 * {@link CLLCommProtocol#FRAME_TEMP1} or {@link CLLCommProtocol#FRAME_TEMP2} 
+	 */
+	public int getTemperatureFrame() {
+		if (mean[CLLCommProtocol.FRAME_TEMP1] < mean[CLLCommProtocol.FRAME_TEMP2])
+			return CLLCommProtocol.FRAME_TEMP2;
+		else
+			return CLLCommProtocol.FRAME_TEMP1;
+	}
+	
+	/*
+	 * converts ticks of a data frame to telemetry value, using mean
+	 * reference and offset 
+	 */
+	private double toValue(int frame, int ticks) {
+		int ref = mean[CLLCommProtocol.FRAME_REFERENCE];
+		int offset = Math.min(
+				mean[CLLCommProtocol.FRAME_TEMP1], 
+				mean[CLLCommProtocol.FRAME_TEMP2] 
+		);
+		
+		if (count == 0 || ref == 0) return 0;
+		
+		return CastleESC.calcValue(frame, ((double) (ticks - offset)) / ((double) ref));
+	}
+	
+	/**
+	 * @param frame data frame identifier (i.e. {@link CLLCommProtocol#FRAME_VOLTAGE})
+	 * @return minimum value for the data frame, in the same unit returned 
+	 * by corresponding {@link CastleESC} getter (output power as a percentage)
+	 */
+	public double getMin(int frame) {
+		//temperature from NTC decreases as ticks increase
+		return Math.min(toValue(frame, min[frame]), toValue(frame, max[frame]));
+	}
+
+	/**
+	 * @param frame data frame identifier (i.e. {@link CLLCommProtocol#FRAME_VOLTAGE})
+	 * @return maximum value for the data frame
+	 * @see CastleESCStats#getMin(int)
+	 */
+	public double getMax(int frame) {
+		return Math.max(toValue(frame, min[frame]), toValue(frame, max[frame]));
+	}
+
+	/**
+	 * @param frame data frame identifier (i.e. {@link CLLCommProtocol#FRAME_VOLTAGE})
+	 * @return mean value for the data frame
+	 * @see CastleESCStats#getMin(int)
+	 */
+	public double getMean(int frame) {
+		return toValue(frame, mean[frame]);
+	}
+
+	/**
+	 * @param frame data frame identifier (i.e. {@link CLLCommProtocol#FRAME_VOLTAGE})
+	 * @return exponentially weighted moving average value for the data frame
+	 * @see CastleESCStats#getMin(int)
+	 */
+	public double getEwma(int frame) {
+		return toValue(frame, ewma[frame]);
+	}
+}
@@ -42,6 +42,7 @@ package it.picciux.castle.linklive;
 
 import java.io.IOException;
 import java.io.OutputStream;
+import java.util.Arrays;
 import java.util.Vector;
 
 /*
@@ -81,6 +82,16 @@ public class CastleLinkLive {
 		 * Command value (if any)
 		 */
 		public int value;
+		
+		/**
+		 * Tag echoed by the ESC interface in the response: 0 for untagged commands
+		 */
+		public int tag = 0;
+		
+		/**
+		 * When a tagged command was sent (System.nanoTime())
+		 */
+		public long sentAt;
 	}
 	
 	/**
@@ -96,6 +107,13 @@ public class CastleLinkLive {
 		private Vector<Command> cmdQueue = new Vector<Command>();
 		private int waitingCommandID = CMD_NONE;
 		
+		// pipelined commands waiting for their response, indexed by tag (0 unused)
+		private Command[] inFlight = new Command[CLLCommProtocol.CMD_TAG_CNT];
+		private int inFlightCount = 0;
+		private int nextTag = 1;
+		private Command failedCommand = null;
+		private boolean pipelineBroken = false;
+		
 		private static final int START_TIMEOUT = 3000;
 		private static final int RUN_TIMEOUT = 2000;
 		
@@ -130,7 +148,12 @@ public class CastleLinkLive {
             interrupt();
 		}
 		
-		public synchronized void ack() {
+		public synchronized void ack(int tag) {
+			if (tag != 0) {
+				taggedReply(tag, true);
+				return;
+			}
+			
 			log.finer("ACK " + waitingCommandID);
 			if (waitingCommandID == CLLCommProtocol.CMD_ARM) setArmed(true);
 			if (waitingCommandID == CLLCommProtocol.CMD_DISARM) setArmed(false);
@@ -140,7 +163,12 @@ public class CastleLinkLive {
 			notify();
 		}
 		
-		public synchronized void nack() {
+		public synchronized void nack(int tag) {
+			if (tag != 0) {
+				taggedReply(tag, false);
+				return;
+			}
+			
 			log.finer("NACK " + waitingCommandID);
 			replied = true;
 			keepRunning = false;
@@ -149,6 +177,31 @@ public class CastleLinkLive {
 		}
 		
 		
+		private void taggedReply(int tag, boolean ack) {
+			Command c = inFlight[tag];
+			
+			if (c == null) {
+				log.warning("Response with unknown tag " + tag);
+				return;
+			}
+			
+			inFlight[tag] = null;
+			inFlightCount--;
+			
+			if (ack) {
+				log.finer("ACK " + c.id + " (tag " + tag + ")");
+				if (c.id == CLLCommProtocol.CMD_ARM) setArmed(true);
+				if (c.id == CLLCommProtocol.CMD_DISARM) setArmed(false);
+				counters.addAckLatency(System.nanoTime() - c.sentAt);
+			} else {
+				log.finer("NACK " + c.id + " (tag " + tag + ")");
+				keepRunning = false;
+				if (failedCommand == null) failedCommand = c;
+			}
+			
+			notify();
+		}
+		
 		public synchronized void postCommand(Command command) {
 			cmdQueue.add(command);
 		}
@@ -165,6 +218,14 @@ public class CastleLinkLive {
 		}
 		
 		private synchronized boolean sendAndWait(Command c, int timeout) {
+			return sendAndWait(c, timeout, true);
+		}
+		
+		/**
+		 * @param failOnTimeout if false, a missing reply is just returned to the caller
+		 * instead of terminating the session
+		 */
+		private synchronized boolean sendAndWait(Command c, int timeout, boolean failOnTimeout) {
 			if (c == null) return true;
 			
 			waitingCommandID = c.id;
@@ -175,6 +236,7 @@ public class CastleLinkLive {
 			/*if (! keepRunning) return false;*/ 
 				
 			sendCommand(c);
+			long sentAt = System.nanoTime();
 			
 			int toWait = timeout;
 			long waitStart = System.currentTimeMillis();
@@ -191,19 +253,156 @@ public class CastleLinkLive {
 			}
 			
 			if (! replied) {
+				if (! failOnTimeout) {
+					waitingCommandID = CMD_NONE;
+					return false;
+				}
 				keepRunning = false;
 				log.warning("Hardware didn't reply. Failed!");
 				escFailed(c, true);
 			} else if (! ack) {
 				log.warning("Hardware didn't ACK. Failed");
 				escFailed(c, false);
-			}
+			} else
+				counters.addAckLatency(System.nanoTime() - sentAt);
 			
 			waitingCommandID = CMD_NONE;
 			return replied;
 		}
 		
 		
+		/**
+		 * Sends a tagged command without waiting for its response. If all tags
+		 * are in flight, waits for a response first
+		 * @return false if the ESC interface didn't reply in time or NACKed a command
+		 */
+		private synchronized boolean sendPipelined(Command c, int timeout) {
+			if (c == null) return true;
+			
+			long deadline = System.currentTimeMillis() + timeout;
+			
+			while ( (inFlightCount == CLLCommProtocol.CMD_TAG_CNT - 1) && (failedCommand == null) ) {
+				long toWait = deadline - System.currentTimeMillis();
+				if (toWait <= 0) return pipelineFailed(true);
+				try {
+					wait(toWait);
+				} catch (InterruptedException e) {
+				}
+			}
+			
+			if (failedCommand != null) return pipelineFailed(false);
+			
+			while (inFlight[nextTag] != null) nextTag = nextTag % (CLLCommProtocol.CMD_TAG_CNT - 1) + 1;
+			
+			c.tag = nextTag;
+			nextTag = nextTag % (CLLCommProtocol.CMD_TAG_CNT - 1) + 1;
+			
+			inFlight[c.tag] = c;
+			inFlightCount++;
+			c.sentAt = System.nanoTime();
+			sendCommand(c);
+			
+			return true;
+		}
+		
+		/**
+		 * Waits until every pipelined command got its response
+		 * @return false if the ESC interface didn't reply in time or NACKed a command
+		 */
+		private synchronized boolean waitPipeline(int timeout) {
+			long deadline = System.currentTimeMillis() + timeout;
+			
+			while ( (inFlightCount > 0) && (failedCommand == null) ) {
+				long toWait = deadline - System.currentTimeMillis();
+				if (toWait <= 0) return pipelineFailed(true);
+				try {
+					wait(toWait);
+				} catch (InterruptedException e) {
+				}
+			}
+			
+			if (failedCommand != null) return pipelineFailed(false);
+			
+			return true;
+		}
+		
+		/**
+		 * Checks that no pipelined command is waiting for its response for more than timeout ms
+		 * @return false if a response is late or a command was NACKed
+		 */
+		private synchronized boolean checkPipeline(int timeout) {
+			long oldest = System.nanoTime() - timeout * 1000000L;
+			
+			if (failedCommand != null) return pipelineFailed(false);
+			
+			for (int t = 1; t < CLLCommProtocol.CMD_TAG_CNT; t++) {
+				if ( (inFlight[t] != null) && (inFlight[t].sentAt - oldest < 0) ) return pipelineFailed(true); 
+			}
+			
+			return true;
+		}
+		
+		private boolean pipelineFailed(boolean timeout) {
+			Command c = failedCommand;
+			
+			if (pipelineBroken) return false; //already reported
+			pipelineBroken = true;
+			
+			if (timeout) {
+				for (int t = 1; t < CLLCommProtocol.CMD_TAG_CNT; t++) {
+					if ( (inFlight[t] != null) && ( (c == null) || (inFlight[t].sentAt - c.sentAt < 0) ) ) c = inFlight[t];
+				}
+				keepRunning = false;
+				log.warning("Hardware didn't reply. Failed!");
+			} else
+				log.warning("Hardware didn't ACK. Failed");
+			
+			escFailed(c, timeout);
+			return false;
+		}
+		
+		/**
+		 * Sends a setup command: pipelined if command pipelining is enabled,
+		 * otherwise waiting for its response
+		 * @return false if the ESC interface didn't reply (or NACKed a pipelined command)
+		 */
+		private boolean sendSetup(Command c) {
+			if (commandPipelining) return sendPipelined(c, START_TIMEOUT);
+			
+			return sendAndWait(c, START_TIMEOUT);
+		}
+		
+		/**
+		 * Switches the link to baudRate: the ESC interface ACKs at the current rate,
+		 * then waits for a HELLO at the new one. If it doesn't answer, both sides
+		 * go back to {@link CastleLinkLive#DEFAULT_BAUD_RATE}
+		 * @return false if the ESC interface didn't answer at any rate
+		 */
+		private boolean switchBaudRate() {
+			int code = Arrays.binarySearch(CLLCommProtocol.BAUD_RATES, baudRate);
+			
+			log.finer("Sending SET_BAUD (" + CLLCommProtocol.CMD_SET_BAUD + ") " + baudRate);
+			if (! sendAndWait(new Command(CLLCommProtocol.CMD_SET_BAUD, code), START_TIMEOUT)) return false;
+			if (! ack) return false;
+			
+			if (baudRateHandler.setBaudRate(baudRate)) {
+				log.finer("Sending HELLO (" + CLLCommProtocol.CMD_HELLO + ") at " + baudRate);
+				if (sendAndWait(new Command(CLLCommProtocol.CMD_HELLO, 0), CLLCommProtocol.BAUD_CONFIRM_TIMEOUT / 2, false)) 
+					return ack;
+				
+				baudRateHandler.setBaudRate(DEFAULT_BAUD_RATE);
+			}
+			
+			log.warning("No answer at " + baudRate + ": going back to " + DEFAULT_BAUD_RATE);
+			try {
+				Thread.sleep(CLLCommProtocol.BAUD_CONFIRM_TIMEOUT); //let the ESC interface go back too
+			} catch (InterruptedException e) {
+			}
+			
+			log.finer("Sending HELLO (" + CLLCommProtocol.CMD_HELLO + ")");
+			return sendAndWait(new Command(CLLCommProtocol.CMD_HELLO, 0), START_TIMEOUT);
+		}
+		
 		@Override
 		public void run() {
 			
@@ -212,20 +411,49 @@ public class CastleLinkLive {
 			} catch (InterruptedException e) {
 			}
 			
+			parser.setCrcMode(CLLCommProtocol.CRCMODE_XOR); //HELLO resets it
 			log.finer("Sending HELLO (" + CLLCommProtocol.CMD_HELLO + ")");
 			if (!sendAndWait(new Command(CLLCommProtocol.CMD_HELLO, 0), START_TIMEOUT)) return;
+			parser.setSequenced(false);
+			counters.resetSequences();
+			
+			if ( (baudRate != DEFAULT_BAUD_RATE) && (baudRateHandler != null) ) {
+				if (! switchBaudRate()) return;
+			}
 
 			log.finer("Sending SET_NESC (" + CLLCommProtocol.CMD_SET_NESC + ") " + escs.size());
-			if (!sendAndWait(new Command(CLLCommProtocol.CMD_SET_NESC, escs.size()), START_TIMEOUT)) return;
+			if (! sendSetup(new Command(CLLCommProtocol.CMD_SET_NESC, escs.size()))) return;
 
 			log.finer("Sending SET_TMIN (" + CLLCommProtocol.CMD_SET_TMIN + ") " + throttleMin);
-			if (! sendAndWait(new Command(CLLCommProtocol.CMD_SET_TMIN, throttleMin), START_TIMEOUT)) return;
+			if (! sendSetup(new Command(CLLCommProtocol.CMD_SET_TMIN, throttleMin))) return;
 
 			log.finer("Sending SET_TMAX (" + CLLCommProtocol.CMD_SET_TMAX + ") " + throttleMax);
-			if (! sendAndWait(new Command(CLLCommProtocol.CMD_SET_TMAX, throttleMax), START_TIMEOUT)) return;
+			if (! sendSetup(new Command(CLLCommProtocol.CMD_SET_TMAX, throttleMax))) return;
 
 			log.finer("Sending SET_TMODE (" + CLLCommProtocol.CMD_SET_TMODE + ") " + throttleMode);
-			if (! sendAndWait(new Command(CLLCommProtocol.CMD_SET_TMODE, throttleMode), START_TIMEOUT)) return;
+			if (! sendSetup(new Command(CLLCommProtocol.CMD_SET_TMODE, throttleMode))) return;
+			
+			if (throttlePeriod != DEFAULT_THROTTLE_PERIOD) {
+				log.finer("Sending SET_TPERIOD (" + CLLCommProtocol.CMD_SET_TPERIOD + ") " + throttlePeriod);
+				if (! sendSetup(new Command(CLLCommProtocol.CMD_SET_TPERIOD, throttlePeriod))) return;
+			}
+			
+			if (dataFormat != FULL_DATA_FORMAT || sequenceNumbers) {
+				int fmt = dataFormat | ( (sequenceNumbers ? CLLCommProtocol.DATAFMT_SEQUENCED : 0) << 8 );
+				log.finer("Sending SET_DATAFMT (" + CLLCommProtocol.CMD_SET_DATAFMT + ") " + fmt);
+				if (! sendSetup(new Command(CLLCommProtocol.CMD_SET_DATAFMT, fmt))) return;
+			}
+			
+			// check mode switch and start need every setting ACKed
+			if (! waitPipeline(START_TIMEOUT)) return;
+			parser.setSequenced(sequenceNumbers);
+			
+			if (crcMode != XOR_CHECKSUM) {
+				log.finer("Sending SET_CRC (" + CLLCommProtocol.CMD_SET_CRC + ") " + crcMode);
+				if (! sendAndWait(new Command(CLLCommProtocol.CMD_SET_CRC, crcMode), START_TIMEOUT)) return;
+				if (! ack) return;
+				parser.setCrcMode(crcMode); //for both directions, from now on
+			}
 
 			log.finer("Sending START (" + CLLCommProtocol.CMD_START + ") " );
 			if (! sendAndWait(new Command(CLLCommProtocol.CMD_START, 0), START_TIMEOUT)) return;
@@ -233,12 +461,28 @@ public class CastleLinkLive {
 			startCompleted();
 			
 			while (isRunning() || (getCommandsInQueueCount() > 0) ) {
-				if (!sendAndWait(commandInQueue(), RUN_TIMEOUT)) break;
-				
-				if (isArmed() && throttleMode == SOFTWARE_THROTTLE) {
-					if (!sendAndWait(new Command(CLLCommProtocol.CMD_SET_THROTTLE, throttle), RUN_TIMEOUT)) break;
+				if (commandPipelining) {
+					Command c;
+					boolean sent = true;
+					
+					while ( sent && ((c = commandInQueue()) != null) ) sent = sendPipelined(c, RUN_TIMEOUT);
+					if (! sent) break;
+					
+					if (isArmed() && throttleMode == SOFTWARE_THROTTLE) {
+						if (! sendPipelined(new Command(CLLCommProtocol.CMD_SET_THROTTLE, throttle), RUN_TIMEOUT)) break;
+					} else {
+						if (! sendPipelined(new Command(CLLCommProtocol.CMD_NOOP, 0), RUN_TIMEOUT)) break;
+					}
+					
+					if (! checkPipeline(RUN_TIMEOUT)) break;
 				} else {
-					if (!sendAndWait(new Command(CLLCommProtocol.CMD_NOOP, 0), RUN_TIMEOUT)) break;
+					if (!sendAndWait(commandInQueue(), RUN_TIMEOUT)) break;
+					
+					if (isArmed() && throttleMode == SOFTWARE_THROTTLE) {
+						if (!sendAndWait(new Command(CLLCommProtocol.CMD_SET_THROTTLE, throttle), RUN_TIMEOUT)) break;
+					} else {
+						if (!sendAndWait(new Command(CLLCommProtocol.CMD_NOOP, 0), RUN_TIMEOUT)) break;
+					}
 				}
 				
 				try {
@@ -248,6 +492,8 @@ public class CastleLinkLive {
 				}
 
 			}
+			
+			if (commandPipelining && ! pipelineBroken) waitPipeline(RUN_TIMEOUT); //last responses (i.e. DISARM)
 
 			stopCompleted();
 		}	
@@ -283,6 +529,53 @@ public class CastleLinkLive {
 	 */
 	public static final int EXTERNAL_THROTTLE = 0;
 	
+	/**
+	 * Data format where the ESC interface sends every data frame of
+	 * every Castle cycle (default, understood by every firmware version).
+	 * Used as parameter of {@link CastleLinkLive#setDataFormat(int)}
+	 */
+	public static final int FULL_DATA_FORMAT = CLLCommProtocol.DATAFMT_FULL;
+	
+	/**
+	 * Data format where the ESC interface sends only data frames changed since
+	 * last transmission, delta-encoded, with periodic absolute keyframes.
+	 * Used as parameter of {@link CastleLinkLive#setDataFormat(int)}
+	 */
+	public static final int COMPACT_DATA_FORMAT = CLLCommProtocol.DATAFMT_COMPACT;
+	
+	/**
+	 * Data format where the ESC interface sends no telemetry data frames:
+	 * only statistics are available, through {@link CastleLinkLive#requestStats(int, boolean)}.
+	 * Used as parameter of {@link CastleLinkLive#setDataFormat(int)}
+	 */
+	public static final int NO_DATA_FORMAT = CLLCommProtocol.DATAFMT_NONE;
+	
+	/**
+	 * Data format where the ESC interface sends data of all ESCs from the same
+	 * telemetry cycle together, in a single frame protected by a CRC.
+	 * Used as parameter of {@link CastleLinkLive#setDataFormat(int)}
+	 */
+	public static final int BATCH_DATA_FORMAT = CLLCommProtocol.DATAFMT_BATCH;
+	
+	/**
+	 * Frames end with a XOR checksum (batch frames with a CRC-8), commands too.
+	 * Used as parameter of {@link CastleLinkLive#setCrcMode(int)}
+	 */
+	public static final int XOR_CHECKSUM = CLLCommProtocol.CRCMODE_XOR;
+	
+	/**
+	 * Frames and commands end with a CRC-8.
+	 * Used as parameter of {@link CastleLinkLive#setCrcMode(int)}
+	 */
+	public static final int CRC8_CHECKSUM = CLLCommProtocol.CRCMODE_CRC8;
+	
+	/**
+	 * Frames end with a CRC-16, commands with a CRC-8: catches swapped or doubled
+	 * bytes a XOR checksum misses, at the cost of one more byte per frame.
+	 * Used as parameter of {@link CastleLinkLive#setCrcMode(int)}
+	 */
+	public static final int CRC16_CHECKSUM = CLLCommProtocol.CRCMODE_CRC16;
+	
 	/**
 	 * Default value for throttle pulse length corresponding to
 	 * idle/break (in microseconds)
@@ -305,6 +598,33 @@ public class CastleLinkLive {
 	 */
 	public static final int ABSOLUTE_THROTTLE_MAX = 2250; //micro seconds
 	
+	/**
+	 * Default period of software generated throttle signal
+	 */
+	public static final int DEFAULT_THROTTLE_PERIOD = 20000; //micro seconds
+	
+	/**
+	 * Time the ESC interface needs after every throttle pulse to read telemetry:
+	 * throttle period cannot be shorter than throttle max pulse plus this time
+	 */
+	public static final int TELEMETRY_WINDOW = 6500; //micro seconds
+	
+	/**
+	 * Maximum period of software generated throttle signal
+	 */
+	public static final int ABSOLUTE_THROTTLE_PERIOD_MAX = 32767; //micro seconds
+	
+	/**
+	 * Serial link rate of the ESC interface after a reset
+	 */
+	public static final int DEFAULT_BAUD_RATE = 38400;
+
+	/**
+	 * Max number of ESCs in a session, as addressed by data frames. Actual max
+	 * depends on the interface board: it refuses a start with more ESCs than it supports 
+	 */
+	public static final int MAX_ESCS = CLLCommProtocol.ESC_ID_MASK + 1;
+	
 	/**
 	 * Vector holding {@link CastleESC} objects to store and return data
 	 */
@@ -315,6 +635,11 @@ public class CastleLinkLive {
 	 */
 	private CLLCommProtocol parser = new CLLCommProtocol();
 	
+	/**
+	 * Link performance counters
+	 */
+	private CastleLinkLiveCounters counters = new CastleLinkLiveCounters(parser);
+	
 	/**
 	 * Event-handler to be set by user
 	 */
@@ -325,6 +650,26 @@ public class CastleLinkLive {
 	 */
 	private int throttleMode = SOFTWARE_THROTTLE;
 	
+	/**
+	 * Data format requested to ESC interface at start
+	 */
+	private int dataFormat = FULL_DATA_FORMAT;
+	
+	/**
+	 * Whether data frames requested to ESC interface carry sequence numbers
+	 */
+	private boolean sequenceNumbers = false;
+	
+	/**
+	 * Frame and command check requested to ESC interface at start
+	 */
+	private int crcMode = XOR_CHECKSUM;
+	
+	/**
+	 * Whether commands are sent tagged, without waiting for the response to the previous one
+	 */
+	private boolean commandPipelining = false;
+	
 	/**
 	 * Throttle value to be sent to ESC interface
 	 */
@@ -340,6 +685,21 @@ public class CastleLinkLive {
 	 */
 	private int throttleMax = DEFAULT_THROTTLE_MAX;
 	
+	/**
+	 * software generated throttle period
+	 */
+	private int throttlePeriod = DEFAULT_THROTTLE_PERIOD;
+	
+	/**
+	 * Serial link rate requested to ESC interface at start
+	 */
+	private int baudRate = DEFAULT_BAUD_RATE;
+	
+	/**
+	 * Switches the host side of the serial link
+	 */
+	private IBaudRateHandler baudRateHandler = null;
+	
 	/**
 	 * Connection status to ESC interface
 	 */
@@ -379,16 +739,17 @@ public class CastleLinkLive {
 				0x00, 0x00, 0x00
 		};
 		
+		boolean useCrc = (parser.getCrcMode() != CLLCommProtocol.CRCMODE_XOR);
 		int checksum = CLLCommProtocol.OUT_HEADER;
-		buf[0] = command.id;
+		buf[0] = command.id | (command.tag << CLLCommProtocol.CMD_TAG_SHIFT);
 		buf[1] = command.value & 0xFF;
 		buf[2] = (command.value >> 8) & 0xFF;
 		
 		try {
-			outStream.write(checksum);
+			outStream.write(CLLCommProtocol.OUT_HEADER);
 			for (int i = 0; i < buf.length; i++) {
 				outStream.write(buf[i]);
-				checksum ^= buf[i];
+				checksum = useCrc ? CLLCommProtocol.crc8Update(checksum, buf[i]) : checksum ^ buf[i];
 			}
 			outStream.write(checksum);
 		} catch (IOException e) {
@@ -423,6 +784,27 @@ public class CastleLinkLive {
 				case CLLCommProtocol.CMD_SET_TMODE:
 					reason = "Cannot set throttle mode to " + command.value; 
 					break;
+				case CLLCommProtocol.CMD_SET_DATAFMT:
+					reason = "Cannot set data format to " + command.value; 
+					break;
+				case CLLCommProtocol.CMD_GET_STATS:
+					reason = "Cannot get stats for ESC " + (command.value & 0xFF); 
+					break;
+				case CLLCommProtocol.CMD_RESET_STATS:
+					reason = "Cannot reset stats for ESC " + command.value; 
+					break;
+				case CLLCommProtocol.CMD_GET_COUNTERS:
+					reason = "Cannot get counters"; 
+					break;
+				case CLLCommProtocol.CMD_SET_TPERIOD:
+					reason = "Cannot set throttle period to " + command.value; 
+					break;
+				case CLLCommProtocol.CMD_SET_BAUD:
+					reason = "Cannot set baud rate to " + baudRate; 
+					break;
+				case CLLCommProtocol.CMD_SET_CRC:
+					reason = "Cannot set CRC mode to " + command.value; 
+					break;
 				case CLLCommProtocol.CMD_START:
 					reason = "ESC interface didn't start";
 					break;
@@ -445,6 +827,27 @@ public class CastleLinkLive {
 			case CLLCommProtocol.CMD_SET_TMODE:
 				reason += "set throttle mode"; 
 				break;
+			case CLLCommProtocol.CMD_SET_DATAFMT:
+				reason += "set data format"; 
+				break;
+			case CLLCommProtocol.CMD_GET_STATS:
+				reason += "get stats command"; 
+				break;
+			case CLLCommProtocol.CMD_RESET_STATS:
+				reason += "reset stats command"; 
+				break;
+			case CLLCommProtocol.CMD_GET_COUNTERS:
+				reason += "get counters command"; 
+				break;
+			case CLLCommProtocol.CMD_SET_TPERIOD:
+				reason += "set throttle period"; 
+				break;
+			case CLLCommProtocol.CMD_SET_BAUD:
+				reason += "set baud rate"; 
+				break;
+			case CLLCommProtocol.CMD_SET_CRC:
+				reason += "set CRC mode"; 
+				break;
 			case CLLCommProtocol.CMD_START:
 				reason += "start command"; 
 				break;
@@ -517,6 +920,24 @@ public class CastleLinkLive {
 		return this.throttle;
 	}
 	
+	/**
+	 * Passes ESC data the parser holds to the corresponding {@link CastleESC}
+	 * @throws InvalidDataException if data is not valid
+	 */
+	private void escDataParsed() throws InvalidDataException {
+		int escId = parser.getId();
+
+		if ( 
+					escId > CLLCommProtocol.NO_ESC &&
+					escId < escs.size() &&
+					escs.get(escId).parseData(parser)
+		) {
+			counters.sampleReceived();
+			if (parser.isSequenced()) counters.sequenceReceived(escId, parser.getSeq());
+			if (eventHandler != null) eventHandler.dataUpdated(escId, escs.get(escId));
+		}
+	}
+	
 	/**
 	 * Puts a single byte (as an int) of data received by hardware interface in the receive
 	 * buffer to be parsed by CastleLinkLive
@@ -529,14 +950,7 @@ public class CastleLinkLive {
 			switch (parser.getType()) {
 			
 				case CLLCommProtocol.TYPE_ESCDATA:
-					int escId = parser.getId();
-
-					if ( 
-								escId > CLLCommProtocol.NO_ESC &&
-								escs.get(escId).parseData(parser) && 
-								eventHandler != null
-					)
-						eventHandler.dataUpdated(escId, escs.get(escId));
+					escDataParsed();
 					
 					// check changes in throttle presence
 					if (throttlePresent != parser.isThrottlePresent()) {
@@ -545,12 +959,37 @@ public class CastleLinkLive {
 					}					
 					break;
 					
+				case CLLCommProtocol.TYPE_BATCH:
+					for (int i = 0; parser.selectBatchEsc(i); i++)
+						escDataParsed();
+					
+					// check changes in throttle presence
+					if (throttlePresent != parser.isThrottlePresent()) {
+						throttlePresent = parser.isThrottlePresent();
+						if (eventHandler != null) eventHandler.throttlePresent(throttlePresent);
+					}					
+					break;
+					
+				case CLLCommProtocol.TYPE_INFO:
+					if (parser.getInfoId() == CLLCommProtocol.INFO_STATS) {
+						int statsEsc = parser.getInfoByte(0);
+						
+						if (statsEsc >= 0 && statsEsc < escs.size()) {
+							escs.get(statsEsc).getStats().parse(parser);
+							if (eventHandler != null) eventHandler.statsUpdated(statsEsc, escs.get(statsEsc));
+						}
+					} else if (parser.getInfoId() == CLLCommProtocol.INFO_COUNTERS) {
+						counters.parse(parser);
+						if (eventHandler != null) eventHandler.countersUpdated(counters);
+					}
+					break;
+					
 				case CLLCommProtocol.TYPE_RESPONSE:
 					if ( (escInterfaceThread != null) ) {
 						if (parser.getResponse() == CLLCommProtocol.RESPONSE_ACK)
-							escInterfaceThread.ack();
+							escInterfaceThread.ack(parser.getResponseTag());
 						else
-							escInterfaceThread.nack();
+							escInterfaceThread.nack(parser.getResponseTag());
 					}
 						
 					break;
@@ -652,6 +1091,57 @@ public class CastleLinkLive {
 		this.throttleMax = throttleMax;
 	}
 
+	/**
+	 * @return period of software generated throttle signal (in microseconds)
+	 */
+	public int getThrottlePeriod() {
+		return throttlePeriod;
+	}
+
+	/**
+	 * Sets period of software generated throttle signal (in microseconds).
+	 * Takes effect at next {@link CastleLinkLive#start(int, int)}. A shorter 
+	 * period gives lower throttle latency and a higher telemetry rate.
+	 * 
+	 * @param throttlePeriod
+	 * @throws InvalidArgumentException if throttlePeriod is shorter than max throttle
+	 * pulse duration plus {@link CastleLinkLive#TELEMETRY_WINDOW}, or longer than 
+	 * {@link CastleLinkLive#ABSOLUTE_THROTTLE_PERIOD_MAX}
+	 */
+	public void setThrottlePeriod(int throttlePeriod) throws InvalidArgumentException {
+		if ( (throttlePeriod < throttleMax + TELEMETRY_WINDOW) || (throttlePeriod > ABSOLUTE_THROTTLE_PERIOD_MAX) )
+			throw new InvalidArgumentException(throttlePeriod + " is not a valid throttle period");
+
+		this.throttlePeriod = throttlePeriod;
+	}
+
+	/**
+	 * @return serial link rate requested to the ESC interface
+	 * @see CastleLinkLive#setBaudRate(int, IBaudRateHandler)
+	 */
+	public int getBaudRate() {
+		return baudRate;
+	}
+
+	/**
+	 * Sets the serial link rate to switch to at next {@link CastleLinkLive#start(int, int)},
+	 * right after the handshake at {@link CastleLinkLive#DEFAULT_BAUD_RATE}. If the ESC interface
+	 * doesn't answer at the new rate, both sides go back to DEFAULT_BAUD_RATE.
+	 * The ESC interface keeps the new rate until it's reset, so the port must be
+	 * at DEFAULT_BAUD_RATE when starting after a reset.
+	 * 
+	 * @param baudRate one of {@link CLLCommProtocol#BAUD_RATES}
+	 * @param handler switches the host side of the link: if null, link stays at DEFAULT_BAUD_RATE
+	 * @throws InvalidArgumentException if baudRate is not supported by the ESC interface
+	 */
+	public void setBaudRate(int baudRate, IBaudRateHandler handler) throws InvalidArgumentException {
+		if (Arrays.binarySearch(CLLCommProtocol.BAUD_RATES, baudRate) < 0)
+			throw new InvalidArgumentException(baudRate + " is not a valid baud rate");
+
+		this.baudRate = baudRate;
+		this.baudRateHandler = handler;
+	}
+
 	/**
 	 * @return whether ESC interface is armed
 	 * @see CastleLinkLive#arm()
@@ -681,6 +1171,50 @@ public class CastleLinkLive {
 		escInterfaceThread.postCommand(new Command(CLLCommProtocol.CMD_ARM, 0));
 	}
 
+	/**
+	 * Asks the ESC interface for telemetry statistics of an ESC. When they
+	 * are received, {@link ICastleLinkLiveEvent#statsUpdated(int, CastleESC)} is
+	 * triggered and they are available through {@link CastleESC#getStats()}
+	 * @param index 0-based ESC index
+	 * @param reset whether ESC interface should restart statistics after sending them
+	 * (i.e. to get statistics over the time between two requests)
+	 * @throws InvalidArgumentException if index is not a valid ESC index
+	 */
+	public void requestStats(int index, boolean reset) throws InvalidArgumentException {
+		if (index < 0 || index >= escs.size())
+			throw new InvalidArgumentException(index + " is not a valid ESC index");
+		
+		if (escInterfaceThread != null)
+			escInterfaceThread.postCommand(new Command(CLLCommProtocol.CMD_GET_STATS, 
+					index | ( (reset ? CLLCommProtocol.STATS_READ_RESET : 0) << 8) ));
+	}
+	
+	/**
+	 * Asks the ESC interface for its link performance counters. When they
+	 * are received, {@link ICastleLinkLiveEvent#countersUpdated(CastleLinkLiveCounters)} is
+	 * triggered and they are available through {@link CastleLinkLive#getCounters()}
+	 */
+	public void requestCounters() {
+		if (escInterfaceThread != null)
+			escInterfaceThread.postCommand(new Command(CLLCommProtocol.CMD_GET_COUNTERS, 0));
+	}
+	
+	/**
+	 * @return link performance counters
+	 * @see CastleLinkLive#requestCounters()
+	 */
+	public CastleLinkLiveCounters getCounters() {
+		return counters;
+	}
+	
+	/**
+	 * Asks the ESC interface to restart telemetry statistics of all ESCs
+	 */
+	public void resetStats() {
+		if (escInterfaceThread != null)
+			escInterfaceThread.postCommand(new Command(CLLCommProtocol.CMD_RESET_STATS, CLLCommProtocol.STATS_ALL_ESCS));
+	}
+	
 	/**
 	 * Asks the ESC interface to stop generating/managing throttle signal,
 	 * whether it is software generated or external
@@ -713,8 +1247,8 @@ public class CastleLinkLive {
 
 		this.throttleMode = throttleMode;
 		
-		if (nESC < 1 || nESC > 2) 
-			throw new InvalidArgumentException("We support 1 or 2 ESC");
+		if (nESC < 1 || nESC > MAX_ESCS) 
+			throw new InvalidArgumentException("We support 1 to " + MAX_ESCS + " ESCs");
 		
 		escs.clear();
 		for (int i = 0; i < nESC; i++)
@@ -792,6 +1326,88 @@ public class CastleLinkLive {
 		return throttleMode;
 	}
 
+	/**
+	 * @return the data format requested to the hardware interface
+	 * @see CastleLinkLive#setDataFormat(int)
+	 */
+	public int getDataFormat() {
+		return dataFormat;
+	}
+
+	/**
+	 * Sets the data format the hardware interface will use to send ESC data.
+	 * Takes effect at next {@link CastleLinkLive#start(int, int)}.
+	 * @param dataFormat can be {@link CastleLinkLive#FULL_DATA_FORMAT}, {@link CastleLinkLive#COMPACT_DATA_FORMAT}
+	 * {@link CastleLinkLive#NO_DATA_FORMAT} or {@link CastleLinkLive#BATCH_DATA_FORMAT}
+	 * @throws InvalidArgumentException if dataFormat is not a valid data format
+	 */
+	public void setDataFormat(int dataFormat) throws InvalidArgumentException {
+		if ( (dataFormat != FULL_DATA_FORMAT) && (dataFormat != COMPACT_DATA_FORMAT) && (dataFormat != NO_DATA_FORMAT) && (dataFormat != BATCH_DATA_FORMAT) )
+			throw new InvalidArgumentException(dataFormat + " is not a valid data format");
+		
+		this.dataFormat = dataFormat;
+	}
+
+	/**
+	 * @return whether data frames requested to the hardware interface carry sequence numbers
+	 * @see CastleLinkLive#setSequenceNumbers(boolean)
+	 */
+	public boolean isSequenceNumbers() {
+		return sequenceNumbers;
+	}
+
+	/**
+	 * Requests the hardware interface to add a per-ESC sequence number to data frames,
+	 * so that lost samples can be counted (see {@link CastleLinkLiveCounters#getSamplesLost()}).
+	 * Takes effect at next {@link CastleLinkLive#start(int, int)}.
+	 * @param sequenceNumbers
+	 */
+	public void setSequenceNumbers(boolean sequenceNumbers) {
+		this.sequenceNumbers = sequenceNumbers;
+	}
+
+	/**
+	 * @return the frame and command check requested to the hardware interface
+	 * @see CastleLinkLive#setCrcMode(int)
+	 */
+	public int getCrcMode() {
+		return crcMode;
+	}
+
+	/**
+	 * Sets how frames and commands exchanged with the hardware interface are checked.
+	 * Takes effect at next {@link CastleLinkLive#start(int, int)}.
+	 * @param crcMode can be {@link CastleLinkLive#XOR_CHECKSUM}, {@link CastleLinkLive#CRC8_CHECKSUM}
+	 * or {@link CastleLinkLive#CRC16_CHECKSUM}
+	 * @throws InvalidArgumentException if crcMode is not a valid mode
+	 */
+	public void setCrcMode(int crcMode) throws InvalidArgumentException {
+		if ( (crcMode != XOR_CHECKSUM) && (crcMode != CRC8_CHECKSUM) && (crcMode != CRC16_CHECKSUM) )
+			throw new InvalidArgumentException(crcMode + " is not a valid CRC mode");
+		
+		this.crcMode = crcMode;
+	}
+
+	/**
+	 * @return whether commands are pipelined
+	 * @see CastleLinkLive#setCommandPipelining(boolean)
+	 */
+	public boolean isCommandPipelining() {
+		return commandPipelining;
+	}
+
+	/**
+	 * Sends commands tagged, keeping up to {@link CLLCommProtocol#CMD_TAG_CNT} - 1 of them
+	 * in flight: responses are matched to commands by tag. Session setup takes fewer
+	 * round trips and throttle updates don't wait for the previous response.
+	 * Needs an ESC interface supporting tagged commands.
+	 * Takes effect at next {@link CastleLinkLive#start(int, int)}.
+	 * @param commandPipelining
+	 */
+	public void setCommandPipelining(boolean commandPipelining) {
+		this.commandPipelining = commandPipelining;
+	}
+
 	/**
 	 * @return whether CastleLinkLive is connected to the ESC interface
 	 */
@@ -0,0 +1,232 @@
+/*****************************************************************************
+ *  CastleLinkLive library - CastleLinkLiveCounters.java
+ *  Copyright (C) 2026  CastleLinkLive contributors
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  For further info, check http://code.google.com/p/castlelinklive4arduino/
+ *
+ *  SVN: $Id$
+ *  
+ *****************************************************************************/
+
+package it.picciux.castle.linklive;
+
+import java.util.Arrays;
+
+/**
+ * Link performance counters: the ones kept by the ESC interface (telemetry
+ * cycles completed, samples sent and dropped, commands lost), updated when the ESC interface 
+ * answers to {@link CastleLinkLive#requestCounters()}, and the ones kept
+ * on this side (samples received and lost, frames with wrong checksum, command 
+ * round-trip latency).
+ * Samples lost are counted only with sequenced frames (see 
+ * {@link CastleLinkLive#setSequenceNumbers(boolean)}): they include samples
+ * the ESC interface couldn't read in time as well as frames lost on the link.
+ * ESC interface counters are free running: compute deltas between two
+ * requests to measure rates.
+ * 
+ * @see CastleLinkLive#getCounters()
+ * @see ICastleLinkLiveEvent#countersUpdated(CastleLinkLiveCounters)
+ */
+public class CastleLinkLiveCounters {
+	/** number of command round-trip latencies kept for percentiles */ 
+	public static final int ACK_LATENCY_SAMPLES = 1024;
+	
+	private long samplesSent = 0;
+	private long samplesDropped = 0;
+	private int commandOverflows = 0;
+	private int commandChecksumErrors = 0;
+	private long cyclesCompleted = 0;
+	
+	private long samplesReceived = 0;
+	private long samplesLost = 0;
+	private long samplesDuplicated = 0;
+	private int[] lastSeq = new int[CLLCommProtocol.ESC_ID_MASK + 1];
+	private CLLCommProtocol parser;
+	
+	private long[] ackLatencies = new long[ACK_LATENCY_SAMPLES];
+	private int ackCount = 0;
+	
+	/* payload layout */
+	private static final int PAYLOAD_SIZE = 16;
+	private static final int LEGACY_PAYLOAD_SIZE = 12; //no cycles completed
+	private static final int SENT_OFFSET = 0;
+	private static final int DROPPED_OFFSET = 4;
+	private static final int OVERFLOWS_OFFSET = 8;
+	private static final int CHECKSUM_ERRORS_OFFSET = 10;
+	private static final int CYCLES_OFFSET = 12;
+	
+	CastleLinkLiveCounters(CLLCommProtocol parser) {
+		this.parser = parser;
+		resetSequences();
+	}
+	
+	/**
+	 * Reads ESC interface counters from an {@link CLLCommProtocol#INFO_COUNTERS} info frame
+	 * @param data a CLLCommProtocol object which parsed the info frame
+	 * @throws InvalidDataException if the info frame is not valid
+	 */
+	synchronized void parse(CLLCommProtocol data) throws InvalidDataException {
+		if (data.getInfoLength() != PAYLOAD_SIZE && data.getInfoLength() != LEGACY_PAYLOAD_SIZE)
+			throw new InvalidDataException("Invalid counters: wrong length " + data.getInfoLength());
+		
+		samplesSent = data.getInfoLong(SENT_OFFSET);
+		samplesDropped = data.getInfoLong(DROPPED_OFFSET);
+		commandOverflows = data.getInfoWord(OVERFLOWS_OFFSET);
+		commandChecksumErrors = data.getInfoWord(CHECKSUM_ERRORS_OFFSET);
+		if (data.getInfoLength() == PAYLOAD_SIZE)
+			cyclesCompleted = data.getInfoLong(CYCLES_OFFSET);
+	}
+	
+	synchronized void sampleReceived() {
+		samplesReceived++;
+	}
+	
+	/**
+	 * Accounts the sequence number of a sample: a gap from the previous 
+	 * one of same ESC means samples lost, same number means the ESC interface
+	 * repeated the last sample (i.e. keepalive without new data)
+	 * @param escId ESC the sample belongs to
+	 * @param seq sequence number (0-255)
+	 */
+	synchronized void sequenceReceived(int escId, int seq) {
+		int last = lastSeq[escId];
+		lastSeq[escId] = seq;
+		
+		if (last < 0) return; //first sample: nothing to compare with
+		
+		if (seq == last)
+			samplesDuplicated++;
+		else
+			samplesLost += (seq - last - 1) & 0xFF;
+	}
+	
+	/**
+	 * Forgets last sequence numbers, i.e. when the ESC interface restarts
+	 */
+	synchronized void resetSequences() {
+		Arrays.fill(lastSeq, -1);
+	}
+	
+	synchronized void addAckLatency(long nanos) {
+		ackLatencies[ackCount % ACK_LATENCY_SAMPLES] = nanos;
+		ackCount++;
+	}
+	
+	/**
+	 * @return telemetry cycles the ESC interface completed, for all ESCs, 
+	 * whether it could send them or not (0 if the ESC interface doesn't
+	 * report them)
+	 */
+	public synchronized long getCyclesCompleted() {
+		return cyclesCompleted;
+	}
+	
+	/**
+	 * @return telemetry samples the ESC interface queued for sending
+	 */
+	public synchronized long getSamplesSent() {
+		return samplesSent;
+	}
+
+	/**
+	 * @return telemetry samples the ESC interface dropped because its
+	 * transmit buffer was full
+	 */
+	public synchronized long getSamplesDropped() {
+		return samplesDropped;
+	}
+
+	/**
+	 * @return commands the ESC interface discarded because its command queue was full
+	 * (16 bit counter)
+	 */
+	public synchronized int getCommandOverflows() {
+		return commandOverflows;
+	}
+
+	/**
+	 * @return commands the ESC interface discarded because of a wrong checksum
+	 * (16 bit counter)
+	 */
+	public synchronized int getCommandChecksumErrors() {
+		return commandChecksumErrors;
+	}
+
+	/**
+	 * @return telemetry samples received here from the ESC interface
+	 */
+	public synchronized long getSamplesReceived() {
+		return samplesReceived;
+	}
+
+	/**
+	 * @return telemetry samples lost, as gaps in sequence numbers
+	 * (always 0 if frames are not sequenced)
+	 */
+	public synchronized long getSamplesLost() {
+		return samplesLost;
+	}
+	
+	/**
+	 * @return samples received again with the previous sequence number
+	 * (ESC interface keepalive while no new data is available)
+	 */
+	public synchronized long getSamplesDuplicated() {
+		return samplesDuplicated;
+	}
+	
+	/**
+	 * @return frames received here and discarded because of a wrong checksum or CRC 
+	 */
+	public long getChecksumErrors() {
+		return parser.getChecksumErrors();
+	}
+	
+	/**
+	 * @return number of command round-trip latencies measured since last
+	 * {@link CastleLinkLiveCounters#resetAckLatencies()} call
+	 */
+	public synchronized int getAckCount() {
+		return ackCount;
+	}
+	
+	/**
+	 * Computes a percentile of command round-trip latency (from command sent
+	 * to ACK received), over the last {@link CastleLinkLiveCounters#ACK_LATENCY_SAMPLES} commands
+	 * @param percentile from 0 to 100 (i.e. 50 for median)
+	 * @return latency in microseconds, or -1 if no command was ACKed yet
+	 */
+	public synchronized long getAckLatency(double percentile) {
+		int n = Math.min(ackCount, ACK_LATENCY_SAMPLES);
+		if (n == 0) return -1;
+		
+		long[] sorted = Arrays.copyOf(ackLatencies, n);
+		Arrays.sort(sorted);
+		
+		int i = (int) Math.ceil(percentile / 100.0d * n) - 1;
+		if (i < 0) i = 0;
+		if (i >= n) i = n - 1;
+		
+		return sorted[i] / 1000;
+	}
+	
+	/**
+	 * Restarts command round-trip latency measurements
+	 */
+	public synchronized void resetAckLatencies() {
+		ackCount = 0;
+	}
+}
@@ -0,0 +1,44 @@
+/*****************************************************************************
+ *  CastleLinkLive library - IBaudRateHandler.java
+ *  Copyright (C) 2026  CastleLinkLive contributors
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  For further info, check http://code.google.com/p/castlelinklive4arduino/
+ *
+ *  SVN: $Id$
+ *  
+ *****************************************************************************/
+
+package it.picciux.castle.linklive;
+
+/**
+ * Interface to be implemented by the owner of the serial port connected
+ * to the ESC interface, to let CastleLinkLive switch the link to a higher
+ * baud rate during the start handshake.
+ * Use {@link CastleLinkLive#setBaudRate(int, IBaudRateHandler)} to pass
+ * an object implementing this interface
+ * @see CastleLinkLive
+ *
+ */
+public interface IBaudRateHandler {
+	/**
+	 * Called when the ESC interface ACKed a baud rate change (or when
+	 * it must be undone because the ESC interface didn't answer at the new rate).
+	 * Implementors must reconfigure their port before returning, without closing it.
+	 * @param baudRate the rate to switch the port to
+	 * @return true if the port was switched, false otherwise
+	 */
+	public boolean setBaudRate(int baudRate);
+}
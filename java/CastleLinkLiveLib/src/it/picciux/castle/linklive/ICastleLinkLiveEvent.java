@@ -43,6 +43,22 @@ public interface ICastleLinkLiveEvent {
 	 */
 	public void dataUpdated(int index, CastleESC esc);
 	
+	/**
+	 * Event triggered when ESC interface answered to a statistics request
+	 * @param index 0-based ESC index
+	 * @param esc {@link CastleESC} object whose {@link CastleESC#getStats()} holds
+	 * updated statistics
+	 * @see CastleLinkLive#requestStats(int, boolean)
+	 */
+	public void statsUpdated(int index, CastleESC esc);
+	
+	/**
+	 * Event triggered when ESC interface answered to a counters request
+	 * @param counters updated {@link CastleLinkLiveCounters} 
+	 * @see CastleLinkLive#requestCounters()
+	 */
+	public void countersUpdated(CastleLinkLiveCounters counters);
+	
 	/**
 	 * Event triggered when ESC interface looses throttle signal or detects a valid
 	 * signal.
@@ -0,0 +1,343 @@
+/*****************************************************************************
+ *  CastleLinkLiveMonitor for windowed systems - CastleLinkLiveBenchmark.java
+ *  Copyright (C) 2026  CastleLinkLive contributors
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  For further info, check http://code.google.com/p/castlelinklive4arduino/
+ *
+ *  SVN: $Id$
+ *  
+ *****************************************************************************/
+
+package it.picciux.castle.linklive.win;
+
+import it.picciux.castle.linklive.CastleESC;
+import it.picciux.castle.linklive.CastleLinkLive;
+import it.picciux.castle.linklive.CLLCommProtocol;
+import it.picciux.castle.linklive.CastleLinkLiveCounters;
+import it.picciux.castle.linklive.IBaudRateHandler;
+import it.picciux.castle.linklive.ICastleLinkLiveEvent;
+import it.picciux.castle.linklive.InvalidArgumentException;
+import it.picciux.castle.linklive.InvalidDataException;
+import it.picciux.commlayer.CommLayerException;
+import it.picciux.commlayer.ICommEventListener;
+import it.picciux.commlayer.log.Logger;
+import it.picciux.commlayer.log.LoggerException;
+import it.picciux.commlayer.win.log.LoggerFactory;
+import it.picciux.commlayer.win.serial.SerialLayer;
+
+/**
+ * Console benchmark of the link between this host and a CastleLinkLiveSerialMonitor
+ * ESC interface. Meant to be run against the monitor built with CLL_BENCHMARK set
+ * in CastleLinkLive_config.h, so that telemetry is synthetic and no ESC is needed.
+ * 
+ * Usage: CastleLinkLiveBenchmark port [baud [nESC [dataFormat [throttlePeriod [seconds]]]]]
+ * 
+ * The port is opened at {@link CastleLinkLive#DEFAULT_BAUD_RATE}: a different baud 
+ * (one of {@link CLLCommProtocol#BAUD_RATES}) is negotiated with the monitor at start,
+ * changing the settings of the open port. Reports telemetry
+ * samples per second, samples dropped by the interface, frames with wrong
+ * checksum, commands lost by the interface and command round-trip latency
+ * percentiles.
+ */
+public class CastleLinkLiveBenchmark {
+	private static final String LOGNAME = "it.picciux.castle.linklive.benchmark";
+	private static final int LOGLEVEL = Logger.WARNING;
+	
+	private static final int CONNECT_TIMEOUT = 10000;
+	private static final int COUNTERS_TIMEOUT = 3000;
+	private static final int WARMUP = 2000;
+	
+	private static Logger log;
+	private static CastleLinkLive cll;
+	private static SerialLayer layer;
+	
+	private static Object lock = new Object();
+	private static boolean connected = false;
+	private static boolean countersReceived = false;
+	private static String error = null;
+	private static long dataErrors = 0;
+	private static int nESC = 1;
+	
+	/*
+	 * counters snapshot at the start of the measure
+	 */
+	private static long startSent;
+	private static long startDropped;
+	private static int startOverflows;
+	private static int startCmdChecksumErrors;
+	private static long startReceived;
+	private static long startLost;
+	private static long startCycles;
+	private static long startChecksumErrors;
+	
+	private static void usage() {
+		System.err.println("Usage: CastleLinkLiveBenchmark port [baud [nESC [dataFormat [throttlePeriod [seconds]]]]]");
+		System.err.println("  dataFormat: " + 
+				CastleLinkLive.FULL_DATA_FORMAT + " full, " + 
+				CastleLinkLive.COMPACT_DATA_FORMAT + " compact, " + 
+				CastleLinkLive.BATCH_DATA_FORMAT + " batch");
+		System.err.println("  throttlePeriod: generated throttle period in microseconds");
+		System.exit(-1);
+	}
+	
+	private static void fail(String reason) {
+		System.err.println("Benchmark failed: " + reason);
+		if (cll != null) cll.stop();
+		if (layer != null) layer.disconnect();
+		System.exit(-1);
+	}
+	
+	/*
+	 * waits for a condition signaled by event handlers
+	 */
+	private static void waitFor(boolean counters, int timeout) {
+		long end = System.currentTimeMillis() + timeout;
+		
+		synchronized (lock) {
+			while ( (counters ? ! countersReceived : ! connected) && (error == null) ) {
+				long toWait = end - System.currentTimeMillis();
+				if (toWait <= 0) break;
+				try {
+					lock.wait(toWait);
+				} catch (InterruptedException e) {
+				}
+			}
+			
+			if (error != null) fail(error);
+			if (counters && ! countersReceived) fail("no answer to counters request");
+			if (! counters && ! connected) fail("cannot connect to ESC interface");
+			
+			countersReceived = false;
+		}
+	}
+	
+	private static double round(double v, int d) {
+		double m = Math.pow(10, d);
+		return Math.round(v * m) / m;
+	}
+	
+	private static void requestCounters() {
+		cll.requestCounters();
+		waitFor(true, COUNTERS_TIMEOUT);
+	}
+	
+	/**
+	 * @param args
+	 */
+	public static void main(String[] args) {
+		String port;
+		int baud = CastleLinkLive.DEFAULT_BAUD_RATE;
+		int dataFormat = CastleLinkLive.FULL_DATA_FORMAT;
+		int throttlePeriod = CastleLinkLive.DEFAULT_THROTTLE_PERIOD;
+		int seconds = 30;
+		
+		if (args.length < 1) usage();
+		
+		port = args[0];
+		try {
+			if (args.length > 1) baud = Integer.parseInt(args[1]);
+			if (args.length > 2) nESC = Integer.parseInt(args[2]);
+			if (args.length > 3) dataFormat = Integer.parseInt(args[3]);
+			if (args.length > 4) throttlePeriod = Integer.parseInt(args[4]);
+			if (args.length > 5) seconds = Integer.parseInt(args[5]);
+		} catch (NumberFormatException e) {
+			usage();
+		}
+		
+		Logger.init(new LoggerFactory());
+		
+		try {
+			log = Logger.getLogger(LOGNAME, Logger.CONSOLE, null);
+		} catch (LoggerException e1) {
+			log = Logger.getNullLogger(LOGNAME);
+		}
+		
+		log.setLevel(LOGLEVEL);
+		
+		cll = new CastleLinkLive();
+		
+		try {
+			cll.setDataFormat(dataFormat);
+			cll.setSequenceNumbers(true);
+			cll.setCommandPipelining(true);
+			cll.setThrottlePeriod(throttlePeriod);
+			if (baud != CastleLinkLive.DEFAULT_BAUD_RATE) {
+				cll.setBaudRate(baud, new IBaudRateHandler() {
+					@Override
+					public boolean setBaudRate(int baudRate) {
+						layer.getSettings().setBaudRate(baudRate);
+						return true;
+					}
+				});
+			}
+		} catch (InvalidArgumentException e) {
+			fail(e.getMessage());
+		}
+		
+		cll.setEventHandler(new ICastleLinkLiveEvent() {
+			@Override
+			public void dataUpdated(int index, CastleESC esc) {
+			}
+
+			@Override
+			public void statsUpdated(int index, CastleESC esc) {
+			}
+
+			@Override
+			public void countersUpdated(CastleLinkLiveCounters counters) {
+				synchronized (lock) {
+					countersReceived = true;
+					lock.notifyAll();
+				}
+			}
+
+			@Override
+			public void throttlePresent(boolean present) {
+			}
+
+			@Override
+			public void connectionEvent(boolean connected) {
+				synchronized (lock) {
+					CastleLinkLiveBenchmark.connected = connected;
+					lock.notifyAll();
+				}
+			}
+
+			@Override
+			public void connectionError(String reason) {
+				synchronized (lock) {
+					error = reason;
+					lock.notifyAll();
+				}
+			}
+
+			@Override
+			public void armedEvent(boolean armed) {
+			}
+		});
+		
+		layer = new SerialLayer();
+		
+		SerialLayer.Settings settings = layer.getSettings();
+		settings.setPort(port);
+		settings.setBaudRate(CastleLinkLive.DEFAULT_BAUD_RATE);
+		settings.setDataBits(SerialLayer.Settings.DATABITS_8);
+		settings.setParity(SerialLayer.Settings.PARITY_NONE);
+		settings.setStopBits(SerialLayer.Settings.STOPBITS_1);
+		settings.setFlowControl(SerialLayer.Settings.FLOWCONTROL_NONE);
+		
+		layer.setInputBufferSize(40);
+		layer.setNotifyOnDataAvailable(true);
+		layer.setWriteOnSeparateThread(false);
+		
+		layer.addEventListener(new ICommEventListener() {
+			@Override
+			public void commLayerEvent(int status, Object extraData) {
+				switch(status) {
+					case SerialLayer.CONNECTED:
+						cll.setOutStream(layer.getOutputStream());
+						try {
+							cll.start(CastleLinkLive.SOFTWARE_THROTTLE, nESC);
+						} catch (InvalidArgumentException e) {
+							synchronized (lock) {
+								error = e.getMessage();
+								lock.notifyAll();
+							}
+						}
+						break;
+						
+					case SerialLayer.DATA_AVAILABLE:
+						int n = ((Integer) extraData).intValue();
+						byte[] data = layer.getData();
+						for (int i = 0; i < n; i++) {
+							try {
+								cll.putData(((int) data[i]) & 0xFF);
+							} catch (InvalidDataException e) {
+								dataErrors++;
+							}
+						}
+						break;
+				}
+			}
+		});
+		
+		try {
+			layer.connect();
+		} catch (CommLayerException ex) {
+			fail(ex.getMessage());
+		}
+		
+		waitFor(false, CONNECT_TIMEOUT);
+		cll.arm();
+		
+		try {
+			Thread.sleep(WARMUP);
+		} catch (InterruptedException e) {
+		}
+		
+		CastleLinkLiveCounters c = cll.getCounters();
+		
+		requestCounters();
+		startSent = c.getSamplesSent();
+		startDropped = c.getSamplesDropped();
+		startOverflows = c.getCommandOverflows();
+		startCmdChecksumErrors = c.getCommandChecksumErrors();
+		startReceived = c.getSamplesReceived();
+		startLost = c.getSamplesLost();
+		startCycles = c.getCyclesCompleted();
+		startChecksumErrors = c.getChecksumErrors();
+		c.resetAckLatencies();
+		long startMs = System.currentTimeMillis();
+		
+		try {
+			Thread.sleep(seconds * 1000L);
+		} catch (InterruptedException e) {
+		}
+		
+		requestCounters();
+		double elapsed = (System.currentTimeMillis() - startMs) / 1000.0d;
+		long received = c.getSamplesReceived() - startReceived;
+		
+		System.out.println("baud rate: " + baud + ", ESCs: " + nESC + ", data format: " + dataFormat + 
+				", throttle period: " + throttlePeriod + " us, " + round(elapsed, 1) + " s");
+		System.out.println("samples received:   " + received + 
+				" (" + round(received / elapsed, 2) + "/s)");
+		System.out.println("cycles completed:   " + (c.getCyclesCompleted() - startCycles));
+		System.out.println("samples sent:       " + (c.getSamplesSent() - startSent));
+		System.out.println("samples lost:       " + (c.getSamplesLost() - startLost));
+		System.out.println("samples dropped:    " + (c.getSamplesDropped() - startDropped));
+		System.out.println("checksum errors:    " + (c.getChecksumErrors() - startChecksumErrors) + 
+				" (data errors: " + dataErrors + ")");
+		System.out.println("commands lost:      " + ((c.getCommandOverflows() - startOverflows) & 0xFFFF) + 
+				" queue full, " + ((c.getCommandChecksumErrors() - startCmdChecksumErrors) & 0xFFFF) + " bad checksum");
+		System.out.println("ACK latency (us):   " + 
+				"p50 " + c.getAckLatency(50) + 
+				", p90 " + c.getAckLatency(90) + 
+				", p99 " + c.getAckLatency(99) + 
+				", max " + c.getAckLatency(100) + 
+				" over " + c.getAckCount() + " commands");
+		
+		cll.stop();
+		
+		try {
+			Thread.sleep(500);
+		} catch (InterruptedException e) {
+		}
+		
+		layer.disconnect();
+		System.exit(0);
+	}
+}
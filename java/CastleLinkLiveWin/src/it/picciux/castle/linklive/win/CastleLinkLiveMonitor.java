@@ -42,6 +42,7 @@ import org.eclipse.swt.widgets.Shell;
 
 import it.picciux.castle.linklive.CastleESC;
 import it.picciux.castle.linklive.CastleLinkLive;
+import it.picciux.castle.linklive.CastleLinkLiveCounters;
 import it.picciux.castle.linklive.ICastleLinkLiveEvent;
 import it.picciux.castle.linklive.InvalidArgumentException;
 import it.picciux.castle.linklive.InvalidDataException;
@@ -127,6 +128,7 @@ public class CastleLinkLiveMonitor {
 	public static final int LOG_NONE = 0;
 	public static final int LOG_RAW = 1;
 	public static final int LOG_HR = 2;
+	public static final int LOG_COLUMNAR = 3;
 	
 	private static Color OKColor;
 	private static Color ProgressColor;
@@ -390,7 +392,7 @@ public class CastleLinkLiveMonitor {
 		//layer.setDataReader(reader);
 		
 		if (appSettings.logType != LOG_NONE && appSettings.logPath.length() > 0) 
-			dataLogger = new DataLogger(appSettings.logPath);
+			dataLogger = new DataLogger(appSettings.logPath, appSettings.logType == LOG_COLUMNAR);
 		
 		if (appSettings.logType == LOG_RAW && dataLogger != null)
 			layer.addDataLogger(dataLogger);
@@ -474,9 +476,20 @@ public class CastleLinkLiveMonitor {
 				});
 				
 				if (appSettings.logType == LOG_HR && dataLogger != null) dataLogger.logESC(esc);
+				if (appSettings.logType == LOG_COLUMNAR && dataLogger != null) dataLogger.logColumns(index, esc);
 				if ((appSettings.hrBroadcastPort > 0) && (hrNetBroadcaster != null)) hrNetBroadcaster.logESC(esc);
 			}
 			
+			@Override
+			public void statsUpdated(final int index, final CastleESC esc) {
+				//monitor streams full data: stats are not requested
+			}
+			
+			@Override
+			public void countersUpdated(final CastleLinkLiveCounters counters) {
+				//counters are not requested
+			}
+			
 			@Override
 			public void connectionEvent(final boolean connected) {
 				final Color c;
@@ -485,7 +498,7 @@ public class CastleLinkLiveMonitor {
 				if (connected) {
 					c = OKColor;
 					logText = "CastleLinkLive is connected!";
-					if (appSettings.logType == LOG_HR && dataLogger != null)
+					if ((appSettings.logType == LOG_HR || appSettings.logType == LOG_COLUMNAR) && dataLogger != null)
 						dataLogger.openLog();
 					
 					if (appSettings.hrBroadcastPort > 0 && hrNetBroadcaster != null) hrNetBroadcaster.openLog();
@@ -493,7 +506,9 @@ public class CastleLinkLiveMonitor {
 					layer.disconnect();
 					c = KOColor;
 					logText = "CastleLinkLive is not connected";
-					if (appSettings.logType == LOG_HR && dataLogger != null)
+					if (appSettings.logType == LOG_COLUMNAR && dataLogger != null)
+						dataLogger.flushColumns();
+					if ((appSettings.logType == LOG_HR || appSettings.logType == LOG_COLUMNAR) && dataLogger != null)
 						dataLogger.closeLog();
 
 					if (appSettings.hrBroadcastPort > 0 && hrNetBroadcaster != null) hrNetBroadcaster.closeLog();
@@ -25,14 +25,25 @@
 package it.picciux.castle.linklive.win;
 
 import it.picciux.castle.linklive.CastleESC;
+import it.picciux.castle.linklive.CastleESCColumns;
+import it.picciux.castle.linklive.CastleLinkLive;
+import it.picciux.commlayer.log.Logger;
 
+import java.io.BufferedOutputStream;
+import java.io.DataOutputStream;
 import java.io.FileNotFoundException;
 import java.io.FileOutputStream;
+import java.io.IOException;
 import java.io.OutputStream;
 
 public class DataLogger extends it.picciux.commlayer.DataLogger {
 	private long startMs = -1;
 	
+	/* columnar log: see CastleESCColumns */
+	private boolean columnar = false;
+	private DataOutputStream columnsStream = null;
+	private CastleESCColumns[] columns = new CastleESCColumns[CastleLinkLive.MAX_ESCS];
+	
 	public DataLogger() {
 		super();
 	}
@@ -41,6 +52,16 @@ public class DataLogger extends it.picciux.commlayer.DataLogger {
 		super(logPath);
 	}
 
+	/**
+	 * @param logPath log file path
+	 * @param columnar true to write a binary columnar log with {@link #logColumns(int, CastleESC)}
+	 * instead of a text one with {@link #logESC(CastleESC)}
+	 */
+	public DataLogger(String logPath, boolean columnar) {
+		super(logPath);
+		this.columnar = columnar;
+	}
+
 	@Override
 	protected OutputStream openStream() {
 		if (logURL.length() == 0) return null;
@@ -53,9 +74,53 @@ public class DataLogger extends it.picciux.commlayer.DataLogger {
 			return null;
 		}
 		
+		if (columnar) {
+			synchronized (this) {
+				columnsStream = new DataOutputStream(new BufferedOutputStream(fos));
+			}
+		}
+		
 		return fos;
 	}
 
+	private void writeColumns(CastleESCColumns c) {
+		if (columnsStream == null || c.getSize() == 0) return;
+		
+		try {
+			c.write(columnsStream);
+			columnsStream.flush();
+		} catch (IOException e) {
+			CastleLinkLiveMonitor.log.log(Logger.SEVERE, "Columnar log write failed", e);
+		}
+		
+		c.clear();
+	}
+
+	/**
+	 * Adds last sample of an ESC to its chunk in the columnar log: the chunk is
+	 * written when full, so call {@link #flushColumns()} before closing the log
+	 * @param index ESC index
+	 * @param esc the ESC
+	 */
+	public synchronized void logColumns(int index, CastleESC esc) {
+		if (index < 0 || index >= columns.length) return;
+		
+		if (columns[index] == null) columns[index] = new CastleESCColumns(index);
+		
+		CastleESCColumns c = columns[index];
+		c.add(System.currentTimeMillis(), esc);
+		if (c.isFull()) writeColumns(c);
+	}
+
+	/**
+	 * Writes chunks of all ESCs to the columnar log, even if not full
+	 */
+	public synchronized void flushColumns() {
+		for (int i = 0; i < columns.length; i++) {
+			if (columns[i] != null) writeColumns(columns[i]);
+		}
+	}
+
 	public void logESC(CastleESC esc) {
 		if (startMs == -1) startMs = System.currentTimeMillis();
 		
@@ -95,20 +95,30 @@ public class PreferencesWindow {
 				logNoneButton.setSelection(true);
 				logRawButton.setSelection(false);
 				logHRButton.setSelection(false);
+				logColumnarButton.setSelection(false);
 				tempSettings.logType = CastleLinkLiveMonitor.LOG_NONE;
 				setLogControls(tempSettings.logType);
 			} else if (e.widget == logRawButton) {
 				logNoneButton.setSelection(false);
 				logRawButton.setSelection(true);
 				logHRButton.setSelection(false);
+				logColumnarButton.setSelection(false);
 				tempSettings.logType = CastleLinkLiveMonitor.LOG_RAW;
 				setLogControls(tempSettings.logType);
 			} else if (e.widget == logHRButton) {
 				logNoneButton.setSelection(false);
 				logRawButton.setSelection(false);
 				logHRButton.setSelection(true);
+				logColumnarButton.setSelection(false);
 				tempSettings.logType = CastleLinkLiveMonitor.LOG_HR;
 				setLogControls(tempSettings.logType);
+			} else if (e.widget == logColumnarButton) {
+				logNoneButton.setSelection(false);
+				logRawButton.setSelection(false);
+				logHRButton.setSelection(false);
+				logColumnarButton.setSelection(true);
+				tempSettings.logType = CastleLinkLiveMonitor.LOG_COLUMNAR;
+				setLogControls(tempSettings.logType);
 			} else if (e.widget == logBrowseButton) {
 				FileDialog d = new FileDialog(w, SWT.SAVE);
 				File lf = new File(logPath.getText());
@@ -193,6 +203,7 @@ public class PreferencesWindow {
 	private Button logNoneButton;
 	private Button logRawButton;
 	private Button logHRButton;
+	private Button logColumnarButton;
 	
 	private Text logPath;
 	private Button logBrowseButton;
@@ -335,6 +346,11 @@ public class PreferencesWindow {
 		logHRButton.setSelection(settings.logType == CastleLinkLiveMonitor.LOG_HR);
 		logHRButton.addSelectionListener(listener);
 		
+		logColumnarButton = new Button(logGroup, SWT.RADIO);
+		logColumnarButton.setText("Columnar (binary)");
+		logColumnarButton.setSelection(settings.logType == CastleLinkLiveMonitor.LOG_COLUMNAR);
+		logColumnarButton.addSelectionListener(listener);
+		
 		logPath = new Text(logGroup, SWT.BORDER);
 		logPath.setText(settings.logPath);
 		